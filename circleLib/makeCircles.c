@@ -35,15 +35,85 @@ void computeChordVec(unsigned char chordVec[], unsigned char radius)
   }
 }
 
+///////////////////////////////////////////
+// transpose chordVec (indexed by column distance, as AbCircle uses it)
+// into rowChords[d]: the circle's 1/2 width at distances d (rows) from center
+///////////////////////////////////////////
+void computeRowChords(unsigned char rowChords[], const unsigned char chordVec[], unsigned char radius)
+{
+  int row, col = radius;
+  for (row = 0; row <= radius; row++) {
+    while (col > 0 && chordVec[col] < row)
+      col--;
+    rowChords[row] = col;
+  }
+}
+
+///////////////////////////////////////////
+// build table chords[d] of ellipse 1/2 widths at distances d (rows) from center
+// chords[d] is the column nearest the ellipse's edge on row d:
+// the largest c with (c - 1/2)**2 / colRadius**2 <= 1 - d**2 / rowRadius**2
+///////////////////////////////////////////
+void computeEllipseChords(unsigned char chords[], unsigned char colRadius, unsigned char rowRadius)
+{
+  long long colSq = (long long)colRadius * colRadius, rowSq = (long long)rowRadius * rowRadius;
+  int row, col = colRadius;
+  for (row = 0; row <= rowRadius; row++) {
+    /* (2col - 1)**2 * rowSq <= 4 * colSq * (rowSq - row**2) */
+    long long limit = 4 * colSq * (rowSq - (long long)row * row);
+    while (col > 0 && (long long)(2 * col - 1) * (2 * col - 1) * rowSq > limit)
+      col--;			/* widths only shrink away from the center */
+    chords[row] = col;
+  }
+}
+
+///////////////////////////////////////////
+// build table pairChords[d] for circles of radii a and b: the largest
+// row distance between their centers at which they still share a pixel
+// when their columns are d apart.  They share one iff in some column
+// both reach it: the sum of their chords there covers the row distance.
+///////////////////////////////////////////
+void computePairChords(unsigned char pairChords[], const unsigned char aChords[], unsigned char a,
+		       const unsigned char bChords[], unsigned char b)
+{
+  int d, col;
+  for (d = 0; d <= a + b; d++) {
+    int best = 0;
+    for (col = (d > b) ? d - b : 0; col <= d && col <= a; col++) /* between the centers */
+      if (aChords[col] + bChords[d - col] > best)
+	best = aChords[col] + bChords[d - col];
+    pairChords[d] = best;
+  }
+}
+
 #include "stdio.h"
 #include "assert.h"
 
 
+// Ellipses to generate: {colRadius, rowRadius}.  Add a line for another.
+static const unsigned char ellipses[][2] = {
+  {10, 5}, {20, 10}, {30, 15}, {40, 20}, {60, 30},
+  {5, 10}, {10, 20}, {15, 30}, {20, 40}, {30, 60},
+};
+
+// Annuli (rings) of the circles of these radii: {outerRadius, innerRadius}
+static const unsigned char annuli[][2] = {
+  {5, 3}, {10, 7}, {10, 5}, {15, 12}, {20, 17}, {20, 15}, {30, 25}, {30, 20},
+  {40, 35}, {50, 45},
+};
+
+// Contact tables of circles of these radii: {radius, radius}
+static const unsigned char circlePairs[][2] = {
+  {3, 3}, {5, 5}, {7, 7}, {10, 10}, {14, 14}, {20, 20},
+  {3, 10}, {5, 10}, {5, 20}, {5, 30}, {10, 20}, {10, 30},
+};
+
 // Generate circles as source files
 // (c) Eric Freudenthal, 2016
 int main()
 {
   int radius;
+  unsigned int i;
   char chordVec[151];
   FILE *circleIncludeFile = fopen("abCircle_decls.h", "w");
   FILE *chordIncludeFile = fopen("chordVec.h", "w");
@@ -72,6 +142,19 @@ int main()
 	fprintf(fp, "    %d, // dist along axis = %d\n", chordVec[chordIndex], chordIndex);
       fprintf(fp, "};\n\n");
       fclose(fp);
+    } {				/* rowChordVecN.c */
+      unsigned char rowChords[151];
+      computeRowChords(rowChords, (unsigned char *)chordVec, radius);
+      sprintf(filename, "circles/rowChordVec%d.c", radius);
+      FILE *fp = fopen(filename, "w");
+      assert(fp);
+      fprintf(fp, "// Automatically generated by makeCircles.\n");
+      fprintf(fp, "#include \"chordVec.h\"\n\n");
+      fprintf(fp, "const unsigned char rowChordVec%d[%d] = {\n", radius, radius+1);
+      for (chordIndex = 0; chordIndex <= radius; chordIndex ++) 
+	fprintf(fp, "    %d, // dist along axis = %d\n", rowChords[chordIndex], chordIndex);
+      fprintf(fp, "};\n\n");
+      fclose(fp);
     } {				/* abCircleN.c */
       sprintf(filename, "circles/abCircle%d.c", radius);
       FILE *fp = fopen(filename, "w");
@@ -86,9 +169,87 @@ int main()
     }
     				/* includes */
     fprintf(chordIncludeFile, "extern const unsigned char chordVec%d[%d];\n", radius, radius+1);
+    fprintf(chordIncludeFile, "extern const unsigned char rowChordVec%d[%d];\n", radius, radius+1);
     fprintf(circleIncludeFile, "extern const AbCircle circle%d;\n" , radius);
   }
 
+  for (i = 0; i < sizeof(ellipses) / sizeof(ellipses[0]); i++) {
+    unsigned char colRadius = ellipses[i][0], rowRadius = ellipses[i][1];
+    unsigned char chords[256];
+    char filename[100];
+    int row;
+    FILE *fp;
+    computeEllipseChords(chords, colRadius, rowRadius);
+    sprintf(filename, "circles/ellipse%dx%d.c", colRadius, rowRadius);
+    fp = fopen(filename, "w");
+    assert(fp);
+    fprintf(fp, "// Automatically generated by makeCircles.\n");
+    fprintf(fp, "#include \"abCircle.h\"\n\n");
+    fprintf(fp, "#include \"chordVec.h\"\n\n");
+    fprintf(fp, "const unsigned char ellipseChords%dx%d[%d] = {\n", colRadius, rowRadius, rowRadius+1);
+    for (row = 0; row <= rowRadius; row++)
+      fprintf(fp, "    %d, // dist along axis = %d\n", chords[row], row);
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "const AbEllipse ellipse%dx%d = {", colRadius, rowRadius);
+    fprintf(fp, "  abEllipseGetBounds, abEllipseCheck, ellipseChords%dx%d, %d, %d",
+	    colRadius, rowRadius, colRadius, rowRadius);
+    fprintf(fp, "};\n");
+    fclose(fp);
+    fprintf(chordIncludeFile, "extern const unsigned char ellipseChords%dx%d[%d];\n",
+	    colRadius, rowRadius, rowRadius+1);
+    fprintf(circleIncludeFile, "extern const AbEllipse ellipse%dx%d;\n", colRadius, rowRadius);
+  }
+
+  for (i = 0; i < sizeof(annuli) / sizeof(annuli[0]); i++) {
+    unsigned char outer = annuli[i][0], inner = annuli[i][1];
+    char filename[100];
+    FILE *fp;
+    assert(inner >= 2 && inner < outer && outer <= 150); /* circles 2..150 exist */
+    sprintf(filename, "circles/annulus%d_%d.c", outer, inner);
+    fp = fopen(filename, "w");
+    assert(fp);
+    fprintf(fp, "// Automatically generated by makeCircles.\n");
+    fprintf(fp, "#include \"abCircle.h\"\n\n");
+    fprintf(fp, "#include \"chordVec.h\"\n\n");
+    fprintf(fp, "const AbAnnulus annulus%d_%d = {", outer, inner);
+    fprintf(fp, "  abAnnulusGetBounds, abAnnulusCheck, rowChordVec%d, rowChordVec%d, %d, %d",
+	    outer, inner, outer, inner);
+    fprintf(fp, "};\n");
+    fclose(fp);
+    fprintf(circleIncludeFile, "extern const AbAnnulus annulus%d_%d;\n", outer, inner);
+  }
+
+  for (i = 0; i < sizeof(circlePairs) / sizeof(circlePairs[0]); i++) {
+    unsigned char a = circlePairs[i][0], b = circlePairs[i][1], radius = a + b;
+    unsigned char aChords[151], bChords[151], chords[256], rowChords[256];
+    char filename[100];
+    int d;
+    FILE *fp;
+    assert(a >= 2 && b >= 2 && a + b <= 255);
+    computeChordVec(aChords, a);
+    computeChordVec(bChords, b);
+    computePairChords(chords, aChords, a, bChords, b);
+    computeRowChords(rowChords, chords, radius);
+    sprintf(filename, "circles/circlePair%d_%d.c", a, b);
+    fp = fopen(filename, "w");
+    assert(fp);
+    fprintf(fp, "// Automatically generated by makeCircles.\n");
+    fprintf(fp, "#include \"abCircle.h\"\n\n");
+    fprintf(fp, "static const unsigned char chords[%d] = {\n", radius+1);
+    for (d = 0; d <= radius; d++)
+      fprintf(fp, "    %d, // dist along axis = %d\n", chords[d], d);
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "static const unsigned char rowChords[%d] = {\n", radius+1);
+    for (d = 0; d <= radius; d++)
+      fprintf(fp, "    %d, // dist along axis = %d\n", rowChords[d], d);
+    fprintf(fp, "};\n\n");
+    fprintf(fp, "const CirclePair circlePair%d_%d = {", a, b);
+    fprintf(fp, "  chords, rowChords, %d", radius);
+    fprintf(fp, "};\n");
+    fclose(fp);
+    fprintf(circleIncludeFile, "extern const CirclePair circlePair%d_%d;\n", a, b);
+  }
+
   fprintf(circleIncludeFile, "\n#endif // included \n");
   fprintf(chordIncludeFile, "\n#endif // included \n");
   fclose(chordIncludeFile);
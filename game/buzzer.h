@@ -6,6 +6,7 @@ void buzzer_set_period(short cycles);
 void winningScreen();
 void welcomeScreen();
 void lostScreen();
+int screenStep();
 void sounds(int state);
 
 #endif // included
@@ -25,113 +25,32 @@
 
 #define SWITCHES (SW0|SW1|SW2|SW3) //Switches are defined for the buttons
 
-//All the bars and squares used in the game are declared as an AbRect
-AbRect rect10 = {abRectGetBounds, abRectCheck, {20,2}}; // 20x2 rectangle 
-AbRect rect11 = {abRectGetBounds, abRectCheck, {20,2}}; // 20x2 rectangle
-AbRect rect12 = {abRectGetBounds, abRectCheck, {20,2}}; // 20x2 rectangle
-AbRect rect15 = {abRectGetBounds, abRectCheck, {6,6}}; //  6x6 square
+//All the bars and squares used in the game are declared as a const AbRect, so they stay in flash
+const AbRect bar = {abRectGetBounds, abRectCheck, {20,2}}; // 20x2 rectangle shared by the bars
+const AbRect square = {abRectGetBounds, abRectCheck, {6,6}}; //  6x6 square
 
 
-AbRectOutline fieldOutline = {	/* playing field */
+const AbRectOutline fieldOutline = {	/* playing field */
   abRectOutlineGetBounds, abRectOutlineCheck,   
   {screenWidth/2-10, screenHeight/2-10}
 };
 
 
-// A layer is created for every AbRect shape 
-Layer layer10 = {
-  (AbShape *)&rect10,
-  {screenWidth/2, 30}, /**< bit below & right of center */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_RED,
-  0
-};
- 
-Layer layer11 = {		/**< Layer with a red square */
-  (AbShape *)&rect11,
-  {screenWidth/2, 80}, /**< center */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_GREEN,
-  &layer10,
-};
-
-Layer layer12 = {		/**< Layer with a green bar */
-  (AbShape *)&rect12,
-  {screenWidth/2, 120}, /**< center */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_YELLOW,
-  &layer11,
-};
-
-Layer layer13 = {		/**< Layer with a black bar */
-  (AbShape *)&rect15,
-  {screenWidth/2, 140}, /**< center */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_BLUE,
-  &layer12,
-};
-
-Layer fieldLayer = {		/* playing field as a layer */
-  (AbShape *) &fieldOutline,
-  {screenWidth/2, screenHeight/2},/**< center */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_BLACK,
-  &layer13,
-};
+// A layer is created for every AbRect shape: shape, color, position (center) and next layer
+LAYER(layer10, &bar, COLOR_RED, screenWidth/2, 30, 0);            /**< red bar */
+LAYER(layer11, &bar, COLOR_GREEN, screenWidth/2, 80, &layer10);   /**< green bar */
+LAYER(layer12, &bar, COLOR_YELLOW, screenWidth/2, 120, &layer11); /**< yellow bar */
+LAYER(layer13, &square, COLOR_BLUE, screenWidth/2, 140, &layer12); /**< blue square */
+LAYER(fieldLayer, &fieldOutline, COLOR_BLACK,			  /* playing field as a layer */
+      screenWidth/2, screenHeight/2, &layer13);
 
-
-/** Moving Layer
- *  Linked list of layer references
- *  Velocity represents one iteration of change (direction & magnitude)
- */
-typedef struct MovLayer_s {
-  Layer *layer;
-  Vec2 velocity;
-  struct MovLayer_s *next;
-} MovLayer;
+LAYER_BAKE(fieldBake, 4, 8);	/* the field never moves: bake its outline */
 
 /* initial value of {0,0} will be overwritten. This part generates the velocity for every layer. I set a 0 velocity in x in order to make the bars only move horizontally */
-MovLayer ml10 = { &layer10, {2,0}, 0 }; // Red bar
-MovLayer ml11 = { &layer11, {3,0}, &ml10 };// Green bar
-MovLayer ml12 = { &layer12, {2,0}, &ml11}; // Yellow bar
-MovLayer ml13 = { &layer13, {0,0}, &ml12 }; // Blue square
-
-void movLayerDraw(MovLayer *movLayers, Layer *layers)
-{
-  int row, col;
-  MovLayer *movLayer;
-
-  and_sr(~8);			/**< disable interrupts (GIE off) */
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Layer *l = movLayer->layer;
-    l->posLast = l->pos;
-    l->pos = l->posNext;
-  }
-  or_sr(8);			/**< disable interrupts (GIE on) */
-
-
-  for (movLayer = movLayers; movLayer; movLayer = movLayer->next) { /* for each moving layer */
-    Region bounds;
-    layerGetBounds(movLayer->layer, &bounds);
-    lcd_setArea(bounds.topLeft.axes[0], bounds.topLeft.axes[1], 
-		bounds.botRight.axes[0], bounds.botRight.axes[1]);
-    for (row = bounds.topLeft.axes[1]; row <= bounds.botRight.axes[1]; row++) {
-      for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; col++) {
-	Vec2 pixelPos = {col, row};
-	u_int color = bgColor;
-	Layer *probeLayer;
-	for (probeLayer = layers; probeLayer; 
-	     probeLayer = probeLayer->next) { /* probe all layers, in order */
-	  if (abShapeCheck(probeLayer->abShape, &probeLayer->pos, &pixelPos)) {
-	    color = probeLayer->color;
-	    break; 
-	  } /* if probe check */
-	} // for checking all layers at col, row
-	lcd_writeColor(color); 
-      } // for col
-    } // for row
-  } // for moving layer being updated
-}	  
+MOVLAYER(ml10, &layer10, 2, 0, 0);     // Red bar
+MOVLAYER(ml11, &layer11, 3, 0, &ml10); // Green bar
+MOVLAYER(ml12, &layer12, 2, 0, &ml11); // Yellow bar
+MOVLAYER(ml13, &layer13, 0, 0, &ml12); // Blue square
 
 int state = 0; // state is a varible used in my state machine which is used in the lives board.
 
@@ -163,6 +82,28 @@ void score(){
   }
 }
 
+/* Collision categories of the layers */
+#define CAT_PLAYER BIT0
+#define CAT_BAR    BIT1
+
+/* The blue square touched a bar: it loses a life, wherever it was hit */
+static void playerHitBar(Layer *player, Layer *bar, const Contact *contact)
+{
+  (void)player; (void)bar; (void)contact;
+  state++;
+  score();
+  sounds(state);
+  drawString5x7(40,152, "Keep Playing", COLOR_BLACK, COLOR_WHITE);
+}
+
+/* Each hit counts once: a pair fires again only after a tick apart */
+static const CollisionRule collisionRules[] = {
+  {CAT_PLAYER, CAT_BAR, playerHitBar, 1},
+};
+COLLISION_REGISTRY(collisions, collisionRules, 2, 2);
+
+int winDue = 0;                 /**< Boolean for whether the square reached the top since main() last looked */
+
 /** Advances a moving shape within a fence
  *  
  *  \param ml The moving shape to be advanced
@@ -170,47 +111,25 @@ void score(){
  */
 void mlAdvance(MovLayer *ml, Region *fence)
 {
-  Vec2 newPos;
-  u_char axis;
+  Vec2 newPos, posNext;
+  u_char axis, i, nHits;
   Region shapeBoundary;
   Region rect; // A new region is created only for the blue square
-  Region bar1; // A new region is created only for the bars blue square
-  MovLayer *head = &ml12;
+  CollideHit hits[3];
 
-  /*The linked list is break in order to separate the blue square from the bars and detect collisions*/
-  for(int i=0; i<2;i++){
-      vec2Add(&newPos, &ml13.layer->posNext, &ml13.velocity);
-      abShapeGetBounds(ml13.layer->abShape, &newPos, &rect);
+  layerGetPosNext(movLayerLayer(&ml13), &posNext);
+  vec2Add(&newPos, &posNext, &ml13.velocity);
+  abShapeGetBounds(layerShape(movLayerLayer(&ml13)), &newPos, &rect);
 
-      vec2Add(&newPos, &head->layer->posNext, &head->velocity);
-      abShapeGetBounds(head->layer->abShape, &newPos, &bar1);
- 
-   for (axis = 0; axis < 2; axis ++) {
-     /*If the blue square touches the top of the gaming field, the player wins*/
-      if(rect.topLeft.axes[1] < fence->topLeft.axes[1]){
-	     winningScreen(); // it calls a function that shows my original rendered shape
-	     drawString5x7(90,152, "WIN", COLOR_BLACK, COLOR_WHITE);
-	     break;
-      }
-
-      /*This part detects the collision between the blue square and the moving bars by checking the        top left and bottom right of the bars and the blue square  */
-      if((rect.topLeft.axes[axis] == bar1.botRight.axes[axis] ||
-	  rect.botRight.axes[axis] == bar1.topLeft.axes[axis] ) &&
-	  rect.topLeft.axes[!axis]-2 > bar1.topLeft.axes[!axis] &&
-	 rect.botRight.axes[!axis]+2 < bar1.botRight.axes[!axis]){
-	    state++;
-	    score();
-	    sounds(state);
-	    drawString5x7(40,152, "Keep Playing", COLOR_BLACK, COLOR_WHITE);
-      }
-   }
-    head = head->next;
- }
+  /*If the blue square touches the top of the gaming field, the player wins*/
+  if(rect.topLeft.axes[1] < fence->topLeft.axes[1])
+    winDue = 1; // main() then shows my original rendered shape
 
   /*This part makes the bars and the blue square move*/
-  for (; ml; ml = ml->next) {
-    vec2Add(&newPos, &ml->layer->posNext, &ml->velocity);
-    abShapeGetBounds(ml->layer->abShape, &newPos, &shapeBoundary);
+  for (; ml; ml = movLayerNext(ml)) {
+    layerGetPosNext(movLayerLayer(ml), &posNext);
+    vec2Add(&newPos, &posNext, &ml->velocity);
+    abShapeGetBounds(layerShape(movLayerLayer(ml)), &newPos, &shapeBoundary);
     
     for (axis = 0; axis < 2; axis ++) {
       if ((shapeBoundary.topLeft.axes[axis] < fence->topLeft.axes[axis]) ||
@@ -225,13 +144,21 @@ void mlAdvance(MovLayer *ml, Region *fence)
 	     buzzer_set_period(550); // every time the square touches a wall, it makes a sound
       }
       }/**< for axis */
-    ml->layer->posNext = newPos;
+    layerSetPosNext(movLayerLayer(ml), &newPos);
   } /**< for ml */
+
+  /*The blue square hits a bar if their boxes meet anywhere between where they were drawn and where they go next, however fast they move*/
+  nHits = collideLayers(&ml13, 0, hits, 3);
+  for (i = 0; i < nHits; i++)
+    if (hits[i].a == movLayerLayer(&ml13))
+      collisionPost(&collisions, hits[i].a, CAT_PLAYER, hits[i].b, CAT_BAR,
+		    &hits[i].contact);
 }
 
 
 u_int bgColor = COLOR_WHITE;    /**< The background color */
 int redrawScreen = 1;           /**< Boolean for whether screen needs to be redrawn */
+int collisionsDue = 0;          /**< Boolean for whether mlAdvance() ran since the last dispatch */
 Region fieldFence;	/**< fence around playing field  */
 
 /** Initializes everything, enables interrupts and green LED, 
@@ -252,6 +179,7 @@ void main()
   buzzer_init();
   
   layerInit(&fieldLayer);
+  layerBake(&fieldLayer, &fieldBake);
   layerDraw(&fieldLayer);
 
   layerGetBounds(&fieldLayer, &fieldFence);
@@ -269,6 +197,18 @@ void main()
     }
     P1OUT |= GREEN_LED;       /**< Green led on when CPU on */
     redrawScreen = 0;
+    if (winDue) {             /**< the screen is drawn by main(), not in the interrupt */
+      winDue = 0;
+      winningScreen();
+    }
+    if (screenStep())	      /**< keep waking up until the screen is drawn */
+      redrawScreen = 1;
+    if (collisionsDue) {      /**< the handlers draw and play sounds: run them here, not in the interrupt */
+      and_sr(~8);	      /**< GIE off: mlAdvance() must not post meanwhile */
+      collisionsDue = 0;
+      collisionDispatch(&collisions);
+      or_sr(8);		      /**< GIE on */
+    }
     movLayerDraw(&ml13, &fieldLayer);
   }
 }
@@ -284,6 +224,7 @@ void wdt_c_handler()
   while(count == 15){
     u_int switches = p2sw_read();
     mlAdvance(&ml13, &fieldFence);
+    collisionsDue = redrawScreen = 1; /**< wake main() to redraw and dispatch the hits */
     count = 0;
     if(~switches & SW3){
       ml13.velocity.axes[0] = 3;
@@ -17,34 +17,60 @@ int abSlicedRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pix
     return abRectCheck(rect, centerPos, pixel);
 }
 
-AbRect rect101 = {abRectGetBounds, abSlicedRectCheck, 10,20};
+const AbRect rect101 = {abRectGetBounds, abSlicedRectCheck, 10,20};
 
 Region fence2 = {{10,30}, {SHORT_EDGE_PIXELS-10, LONG_EDGE_PIXELS-10}};
 
 /*I used three layer to create three same figures */
-Layer myShape = {
-  (AbShape *)&rect101,
-  {screenWidth/2, screenHeight/2}, /* position */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_RED,
-  0,
-};
+LAYER(myShape, &rect101, COLOR_RED, screenWidth/2, screenHeight/2, 0);
+LAYER(myShape2, &rect101, COLOR_GREEN, 40, 90, &myShape);
+LAYER(myShape3, &rect101, COLOR_YELLOW, 90, 90, &myShape2);
 
-Layer myShape2 = {
-  (AbShape *)&rect101,
-  {40, 90}, /* position */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_GREEN,
-  &myShape,
-};
+/* Full-screen redraws are spread over several passes of the main loop 
+   so that the switches, buzzer and bars keep running while they draw. */
+#define SCREEN_ROWS_PER_SLICE 8	/* rows rendered per call to screenStep() */
+
+typedef struct {
+  u_char col, row;
+  char *text;
+} ScreenText;
 
-Layer myShape3 = {
-  (AbShape *)&rect101,
-  {90, 90}, /* position */
-  {0,0}, {0,0},				    /* last & next pos */
-  COLOR_YELLOW,
-  &myShape2,
+static const ScreenText welcomeText[] = {
+  {25, 20, "WELCOME!"}, {35, 30, "LET'S PLAY!"}, {0, 0, 0}
 };
+static const ScreenText winningText[] = {
+  {25, 20, "CONGRATULATION"}, {35, 30, "YOU WON!"}, {90, 152, "WIN"}, {0, 0, 0}
+};
+static const ScreenText lostText[] = {
+  {35, 40, "YOU LOST!"}, {0, 0, 0}
+};
+
+static LayerDrawJob screenJob;	/* screen being drawn */
+static const ScreenText *screenText; /* its text, written when done */
+
+/* starts drawing a screen unless it is already being drawn.
+   Called from main() only: screenStep() may be inside the job. */
+static void screenBegin(const ScreenText *text)
+{
+  static const Region screen = {{0,0}, {screenWidth-1, screenHeight-1}};
+  if (text == screenText && !layerDrawDone(&screenJob))
+    return;
+  screenText = text;
+  layerInit(&myShape3);
+  layerDrawBegin(&screenJob, &myShape3, &screen);
+}
+
+/* draws the next slice of the current screen, true while rows remain */
+int screenStep()
+{
+  const ScreenText *t;
+  if (layerDrawDone(&screenJob))
+    return 0;
+  if (layerDrawStep(&screenJob, SCREEN_ROWS_PER_SLICE))
+    for (t = screenText; t->text; t++)
+      drawString5x7(t->col, t->row, t->text, COLOR_BLACK, COLOR_WHITE);
+  return !layerDrawDone(&screenJob);
+}
 
 /* function that is activated once the game starts*/
 void welcomeScreen()
@@ -52,56 +78,19 @@ void welcomeScreen()
   configureClocks();
   lcd_init();
   shapeInit();
-  Vec2 rectPos = screenCenter;//, circlePos = {30,screenHeight - 30};
-    
-  clearScreen(COLOR_BLUE);
-  clearScreen(COLOR_GREEN);
-  clearScreen(COLOR_RED);
-  clearScreen(COLOR_YELLOW);
-  
-
-  layerDraw(&myShape3);
-  
-  drawString5x7(25,20, "WELCOME!", COLOR_BLACK, COLOR_WHITE);
-  drawString5x7(35,30, "LET'S PLAY!", COLOR_BLACK, COLOR_WHITE);
-  
+  screenBegin(welcomeText);
+  while (screenStep())		/* interrupts are not enabled yet */
+    ;
 }
 
 /* function that is activated once the player wins*/
 void winningScreen()
 {
-  configureClocks();
-  lcd_init();
-  shapeInit();
-  Vec2 rectPos = screenCenter;//, circlePos = {30,screenHeight - 30};
-    
-  clearScreen(COLOR_YELLOW);
-  clearScreen(COLOR_GREEN);
-  clearScreen(COLOR_RED);
-  clearScreen(COLOR_BLUE);
-  
-
-  layerDraw(&myShape3);
-  
-  drawString5x7(25,20, "CONGRATULATION", COLOR_BLACK, COLOR_WHITE);
-  drawString5x7(35,30, "YOU WON!", COLOR_BLACK, COLOR_WHITE);
-  
+  screenBegin(winningText);
 }
 
 /* function that is activated once the player lost*/
 void lostScreen()
 {
-  configureClocks();
-  lcd_init();
-  shapeInit();
-  Vec2 rectPos = screenCenter;//, circlePos = {30,screenHeight - 30};
-  
-  clearScreen(COLOR_BLUE);
-  clearScreen(COLOR_RED);
-  clearScreen(COLOR_BLUE);
-  clearScreen(COLOR_RED);
-  
-  layerDraw(&myShape3);
-  drawString5x7(35,40, "YOU LOST!", COLOR_BLACK, COLOR_WHITE);
-
+  screenBegin(lostText);
 }
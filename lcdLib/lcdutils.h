@@ -14,6 +14,7 @@ extern const unsigned char font_5x7[96][5];
 extern const unsigned char font_8x12[95][12];
 extern const unsigned int font_11x16[95][11];
 
+/** The default palette: every COLOR_ below, indexed by PAL_ */
 extern const unsigned int colors[43];
 
 
@@ -106,4 +107,31 @@ void lcd_writeColor(u_int colorBGR);
 #define COLOR_PURPLE		0xf114
 #define COLOR_MEDIUM_PURPLE	0xdb92
 
+/** Palette indices of the COLOR_ values in colors[] */
+enum {
+  PAL_BLACK, PAL_WHITE, PAL_BLUE, PAL_RED, PAL_GREEN, PAL_CYAN,
+  PAL_MAGENTA, PAL_YELLOW, PAL_ORANGE, PAL_ORANGE_RED, PAL_DARK_ORANGE,
+  PAL_GRAY, PAL_NAVY, PAL_ROYAL_BLUE, PAL_SKY_BLUE, PAL_TURQUOISE,
+  PAL_STEEL_BLUE, PAL_LIGHT_BLUE, PAL_AQUAMARINE, PAL_DARK_GREEN,
+  PAL_DARK_OLIVE_GREEN, PAL_SEA_GREEN, PAL_SPRING_GREEN,
+  PAL_PALE_GREEN, PAL_GREEN_YELLOW, PAL_LIME_GREEN, PAL_FOREST_GREEN,
+  PAL_KHAKI, PAL_GOLD, PAL_GOLDENROD, PAL_SIENNA, PAL_BEIGE, PAL_TAN,
+  PAL_BROWN, PAL_CHOCOLATE, PAL_FIREBRICK, PAL_HOT_PINK, PAL_PINK,
+  PAL_DEEP, PAL_VIOLET, PAL_DARK_VIOLE, PAL_PURPLE, PAL_MEDIUM_PURPLE,
+  PAL_COLORS
+};
+
+/** The active palette: up to 256 BGR colors, usually const (in flash).
+ *  Anything drawn with palette indices is drawn from it.
+ */
+extern const u_int *palette;
+
+/** Switches the active palette, e.g. to cycle colors.  Takes effect on
+ *  the next redraw.
+ */
+void paletteSet(const u_int *pal);
+
+/** BGR color of palette entry i */
+#define paletteColor(i) (palette[i])
+
 #endif /* lcdutils_included */
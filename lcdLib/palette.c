@@ -0,0 +1,58 @@
+/** \file palette.c
+ *  \brief Palettes of BGR colors
+ */
+#include "lcdutils.h"
+
+const unsigned int colors[43] = {
+  COLOR_BLACK,
+  COLOR_WHITE,
+  COLOR_BLUE,
+  COLOR_RED,
+  COLOR_GREEN,
+  COLOR_CYAN,
+  COLOR_MAGENTA,
+  COLOR_YELLOW,
+  COLOR_ORANGE,
+  COLOR_ORANGE_RED,
+  COLOR_DARK_ORANGE,
+  COLOR_GRAY,
+  COLOR_NAVY,
+  COLOR_ROYAL_BLUE,
+  COLOR_SKY_BLUE,
+  COLOR_TURQUOISE,
+  COLOR_STEEL_BLUE,
+  COLOR_LIGHT_BLUE,
+  COLOR_AQUAMARINE,
+  COLOR_DARK_GREEN,
+  COLOR_DARK_OLIVE_GREEN,
+  COLOR_SEA_GREEN,
+  COLOR_SPRING_GREEN,
+  COLOR_PALE_GREEN,
+  COLOR_GREEN_YELLOW,
+  COLOR_LIME_GREEN,
+  COLOR_FOREST_GREEN,
+  COLOR_KHAKI,
+  COLOR_GOLD,
+  COLOR_GOLDENROD,
+  COLOR_SIENNA,
+  COLOR_BEIGE,
+  COLOR_TAN,
+  COLOR_BROWN,
+  COLOR_CHOCOLATE,
+  COLOR_FIREBRICK,
+  COLOR_HOT_PINK,
+  COLOR_PINK,
+  COLOR_DEEP,
+  COLOR_VIOLET,
+  COLOR_DARK_VIOLE,
+  COLOR_PURPLE,
+  COLOR_MEDIUM_PURPLE,
+};
+
+const u_int *palette = colors;
+
+void
+paletteSet(const u_int *pal)
+{
+  palette = pal;
+}
@@ -0,0 +1,141 @@
+#include "shape.h"
+
+#if LAYER_LAYOUT != LAYER_LAYOUT_COMPACT
+
+/* true if the runs starting at a and b (n of each) are identical */
+static int
+runsEqual(const LayerRun *a, const LayerRun *b, u_char n)
+{
+  for (; n; n--, a++, b++)
+    if (a->colStart != b->colStart || a->colEnd != b->colEnd)
+      return 0;
+  return 1;
+}
+
+/* bakes l's shape at its current position, false if it does not fit */
+static int
+bakeShape(const Layer *l, LayerBake *bake)
+{
+  Region bounds;
+  Vec2 pos;
+  int row, col;
+  LayerBand *band = 0;		/* band being extended */
+
+  bake->bandCount = bake->runCount = bake->band = 0;
+  layerGetPos(l, &pos);
+  abShapeGetBounds(layerShape(l), &pos, &bounds);
+  vec2Max(&bounds.topLeft, &bounds.topLeft, &vec2Zero);
+  if (bounds.botRight.axes[0] >= screenWidth)
+    bounds.botRight.axes[0] = screenWidth - 1;
+  if (bounds.botRight.axes[1] >= screenHeight)
+    bounds.botRight.axes[1] = screenHeight - 1;
+
+  for (row = bounds.topLeft.axes[1]; row <= bounds.botRight.axes[1]; row++) {
+    u_char firstRun = bake->runCount;
+    char inRun = 0;
+    for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; col++) {
+      Vec2 pixelPos = {col, row};
+      int covered = abShapeCheck(layerShape(l), &pos, &pixelPos);
+      if (covered && !inRun) {	/* start a run */
+	if (bake->runCount == bake->runMax)
+	  return 0;
+	bake->runs[bake->runCount].colStart = col;
+	bake->runCount++;
+      }
+      if (covered)
+	bake->runs[bake->runCount-1].colEnd = col;
+      inRun = covered;
+    }
+    u_char runCount = bake->runCount - firstRun;
+    if (!runCount) {		/* empty row ends the band */
+      band = 0;
+    } else if (band && band->runCount == runCount &&
+	       runsEqual(&bake->runs[band->firstRun], &bake->runs[firstRun], runCount)) {
+      band->rowEnd = row;	/* same runs as the row above */
+      bake->runCount = firstRun;
+    } else {
+      if (bake->bandCount == bake->bandMax)
+	return 0;
+      band = &bake->bands[bake->bandCount++];
+      band->rowStart = band->rowEnd = row;
+      band->firstRun = firstRun;
+      band->runCount = runCount;
+    }
+  }
+  return 1;
+}
+
+#endif
+
+int
+layerBake(Layer *l, LayerBake *bake)
+{
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+  return 0;			/* no room for a bake reference */
+#else
+  bake->abShape = layerShape(l);
+  layerGetPos(l, &bake->pos);
+  bake->valid = bakeShape(l, bake);
+  l->bake = bake;
+  return bake->valid;
+#endif
+}
+
+void
+layerBakeRefresh(Layer *layers)
+{
+  for (; layers; layers = layerNext(layers)) {
+    LayerBake *bake = layerBakeOf(layers);
+    Vec2 pos;
+    if (!bake)
+      continue;
+    layerGetPos(layers, &pos);
+    if (bake->abShape != layerShape(layers) ||
+	bake->pos.axes[0] != pos.axes[0] || bake->pos.axes[1] != pos.axes[1])
+      layerBake(layers, bake);
+  }
+}
+
+int
+layerRun(Layer *l, const Vec2 *pixel, int *runEnd)
+{
+  LayerBake *bake = layerBakeOf(l);
+  Vec2 pos;
+  if (bake && bake->valid) {
+    int row = pixel->axes[1], col = pixel->axes[0];
+    const LayerBand *band;
+    const LayerRun *run;
+    u_char i;
+    *runEnd = RUN_END_MAX;
+    if (bake->band >= bake->bandCount || bake->bands[bake->band].rowStart > row)
+      bake->band = 0;		/* rows are usually visited in order */
+    for (band = &bake->bands[bake->band]; bake->band < bake->bandCount;
+	 band++, bake->band++) {
+      if (row > band->rowEnd)
+	continue;
+      if (row < band->rowStart)
+	return 0;		/* row between bands */
+      for (i = band->runCount, run = &bake->runs[band->firstRun]; i; i--, run++) {
+	if (col < run->colStart) {
+	  *runEnd = run->colStart - 1;
+	  return 0;
+	}
+	if (col <= run->colEnd) {
+	  *runEnd = run->colEnd;
+	  return 1;
+	}
+      }
+      return 0;
+    }
+    return 0;
+  }
+  layerGetPos(l, &pos);
+  return abShapeRun(layerShape(l), &pos, pixel, runEnd);
+}
+
+int
+layerCheck(Layer *l, const Vec2 *pixel)
+{
+  int runEnd;
+  return layerRun(l, pixel, &runEnd);
+}
@@ -0,0 +1,165 @@
+// Times a full frame of rect, arrow, circle and outline layers drawn by
+// layerDraw() against the paths it replaced: a check per layer per pixel,
+// and runs found through the check pointers, with arrows and circles
+// still checked pixel by pixel.  Counts the probes of the old paths and
+// checks that all three draw the same frame.
+// Runs on the host, built by the Makefile; times are host ns.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "shape.h"
+#include "hostLcd.h"
+
+#define FRAMES 200
+
+const AbRect rect10 = {abRectGetBounds, abRectCheck, {10,10}};
+const AbRArrow rightArrow = {abRArrowGetBounds, abRArrowCheck, 30};
+u_char chords30[31];
+const AbCircle circle30 = {abCircleGetBounds, abCircleCheck, chords30, 30};
+const AbRectOutline fieldOutline = {
+  abRectOutlineGetBounds, abRectOutlineCheck,
+  {screenWidth/2-10, screenHeight/2-10}
+};
+
+LAYER(rectLayer, &rect10, COLOR_RED, 40, 40, 0);
+LAYER(arrowLayer, &rightArrow, COLOR_GREEN, 80, 60, &rectLayer);
+LAYER(circleLayer, &circle30, COLOR_BLUE, screenWidth/2, 110, &arrowLayer);
+LAYER(fieldLayer, &fieldOutline, COLOR_BLACK, screenWidth/2, screenHeight/2, &circleLayer);
+
+unsigned long probes;		/* checks or runs asked of a shape */
+
+/** The compositor before runs: every layer checked at every pixel */
+void
+perPixelDraw(Layer *layers)
+{
+  int row, col;
+  for (row = 0; row < screenHeight; row++) {
+    lcd_setArea(0, row, screenWidth-1, row);
+    for (col = 0; col < screenWidth; col++) {
+      Vec2 pixelPos = {col, row};
+      Layer *probeLayer;
+      u_int color = bgColor;
+      for (probeLayer = layers; probeLayer; probeLayer = layerNext(probeLayer)) {
+	probes++;
+	if (abShapeCheck(layerShape(probeLayer), &probeLayer->pos, &pixelPos)) {
+	  color = layerColorBGR(layerColor(probeLayer));
+	  break;
+	}
+      }
+      lcd_writeColor(color);
+    }
+  }
+}
+
+/** abShapeRun() before shape kinds: the check pointer picks the run */
+int
+pointerRun(const AbShape *s, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  void *check = (void *)s->check;
+  probes++;
+  if (check == (void *)abRectCheck)
+    return abRectRun((const AbRect *)s, centerPos, pixel, runEnd);
+  if (check == (void *)abRectOutlineCheck)
+    return abRectOutlineRun((const AbRect *)s, centerPos, pixel, runEnd);
+  if (check == (void *)abBitmapCheck)
+    return abBitmapRun((const AbBitmap *)s, centerPos, pixel, runEnd);
+  if (check == (void *)abInstancesCheck)
+    return abInstancesRun((const AbInstances *)s, centerPos, pixel, runEnd);
+  *runEnd = pixel->axes[0];	/* no fast path: one pixel at a time */
+  return (*s->check)(s, centerPos, pixel);
+}
+
+#define RUNS_MAX 16
+
+/** The row-span compositor before shape kinds */
+void
+pointerDraw(Layer *layers)
+{
+  int row, col;
+  int runEnd[RUNS_MAX];
+  char covered[RUNS_MAX];
+  lcd_setArea(0, 0, screenWidth-1, screenHeight-1);
+  for (row = 0; row < screenHeight; row++) {
+    u_int i;
+    for (i = 0; i < RUNS_MAX; i++)
+      runEnd[i] = -1;
+    for (col = 0; col < screenWidth; ) {
+      Vec2 pixelPos = {col, row};
+      Layer *probeLayer, *hit = 0;
+      int end = screenWidth - 1;
+      u_int color;
+      for (probeLayer = layers, i = 0; probeLayer; probeLayer = layerNext(probeLayer), i++) {
+	if (runEnd[i] < col)
+	  covered[i] = pointerRun(layerShape(probeLayer), &probeLayer->pos,
+				  &pixelPos, &runEnd[i]);
+	if (runEnd[i] < end)
+	  end = runEnd[i];
+	if (covered[i]) {
+	  hit = probeLayer;
+	  break;
+	}
+      }
+      color = hit ? layerColorBGR(layerColor(hit)) : bgColor;
+      for (; col <= end; col++)
+	lcd_writeColor(color);
+    }
+  }
+}
+
+/** Host ns since some fixed point */
+double
+hostNs()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** Draws FRAMES frames with draw; returns host ns per frame */
+double
+timeDraw(void (*draw)(Layer *), unsigned long *probesPerFrame)
+{
+  double start;
+  int f;
+  probes = 0;
+  start = hostNs();
+  for (f = 0; f < FRAMES; f++)
+    draw(&fieldLayer);
+  *probesPerFrame = probes / FRAMES;
+  return (hostNs() - start) / FRAMES;
+}
+
+u_int reference[screenHeight][screenWidth];
+
+int
+main()
+{
+  const long pixels = (long)screenWidth * screenHeight;
+  unsigned long perPixelProbes, pointerProbes, unused;
+  double perPixelNs, pointerNs, kindNs;
+  u_int bad = 0;
+  int r, col = 30;
+  for (r = 0; r <= 30; r++) {	/* chords of a circle of radius 30 */
+    while (col * col + r * r > 900)
+      col--;
+    chords30[r] = col;
+  }
+  layerInit(&fieldLayer);
+
+  perPixelNs = timeDraw(perPixelDraw, &perPixelProbes);
+  memcpy(reference, hostScreen, sizeof reference);
+  pointerNs = timeDraw(pointerDraw, &pointerProbes);
+  bad += memcmp(reference, hostScreen, sizeof reference) != 0;
+  kindNs = timeDraw(layerDraw, &unused);
+  bad += memcmp(reference, hostScreen, sizeof reference) != 0;
+
+  printf("benchDispatch: per pixel: %7.0f ns/frame (%4.1f ns/pixel), %lu checks\n",
+	 perPixelNs, perPixelNs / pixels, perPixelProbes);
+  printf("benchDispatch: check pointers: %7.0f ns/frame (%4.1f ns/pixel), %lu probes\n",
+	 pointerNs, pointerNs / pixels, pointerProbes);
+  printf("benchDispatch: shape kinds: %7.0f ns/frame (%4.1f ns/pixel)\n",
+	 kindNs, kindNs / pixels);
+  printf("benchDispatch: %u frames differ\n", bad);
+  return bad != 0;
+}
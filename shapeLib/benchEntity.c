@@ -0,0 +1,178 @@
+// Times a tick (step, collide, sync) of an EntityStore against the same
+// work on pointer-linked pooled Layers with Motions and a BroadPhase,
+// and how much of the store's tick entityStoreSync() takes.  Checks the
+// pairs found and the frames drawn through the store's layers.
+// Runs on the host, built by the Makefile; times are host ns.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "shape.h"
+#include "hostLcd.h"
+
+#define N 64
+#define TICKS 20000
+
+const AbRect rect3 = {abRectGetBounds, abRectCheck, {3,3}};
+u_char chords5[6];
+const AbCircle circle5 = {abCircleGetBounds, abCircleCheck, chords5, 5};
+const AbShape *const shapes[] = {(const AbShape *)&rect3, (const AbShape *)&circle5};
+
+ENTITY_STORE(store, N, shapes);
+MOVLAYER_POOL(storePool, N);
+
+MOVLAYER_POOL(pool, N);		/* the same objects as layers */
+Motion motions[N];
+BROAD_PHASE(bp, N);
+
+EntityPair entityPairs[255];
+LayerPair layerPairs[255];
+u_int drawn[screenHeight][screenWidth];
+u_int bad;
+
+/** Turns v around at the edges of the screen */
+void
+bounce(const Vec2 *p, Vec2 *v)
+{
+  u_char axis;
+  for (axis = 0; axis < 2; axis++) {
+    int last = (axis ? screenHeight : screenWidth) - 10;
+    if ((p->axes[axis] < 10 && v->axes[axis] < 0) ||
+	(p->axes[axis] > last && v->axes[axis] > 0))
+      v->axes[axis] = -v->axes[axis];
+  }
+}
+
+/** The same n objects, spawned into the store or the pool, from seed */
+void
+spawnAll(int n, int intoStore)
+{
+  int i;
+  srand(n);
+  for (i = 0; i < n; i++) {
+    Vec2 pos = {10 + rand() % (screenWidth - 20), 10 + rand() % (screenHeight - 20)};
+    Vec2 velocity = {rand() % 513 - 256, rand() % 513 - 256}; /* Q8.8, +-1 pixel */
+    u_char category = 1 << (i % 2);
+    if (intoStore) {
+      if (entitySpawn(&store, i % 2, COLOR_RED,
+		      ENTITY_MOVES | ENTITY_COLLIDES | ENTITY_VISIBLE,
+		      category, 3, &pos, &velocity) == ENTITY_NONE)
+	bad++;
+    } else {
+      LayerHandle h = layerPoolSpawn(&pool, shapes[i % 2], COLOR_RED, &pos, &vec2Zero);
+      motions[i].layer = layerPoolLayer(&pool, h);
+      motions[i].velocity = velocity;
+      motions[i].accel = vec2Zero;
+      motions[i].frac[0] = motions[i].frac[1] = 0;
+      broadPhaseAdd(&bp, motions[i].layer, category, 3);
+    }
+  }
+}
+
+/** Host ns since some fixed point */
+double
+hostNs()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+double syncNs;			/* spent in entityStoreSync() */
+
+/** One tick of the store */
+u_char
+storeTick()
+{
+  u_char i, n;
+  double start;
+  entityStoreStep(&store);
+  for (i = 0; i < store.nMoving; i++) {
+    u_char e = store.moving[i];
+    bounce(&store.pos[e], &store.velocity[e]);
+  }
+  n = entityStoreCollide(&store, entityPairs, 255);
+  start = hostNs();
+  entityStoreSync(&store);
+  syncNs += hostNs() - start;
+  return n;
+}
+
+/** Pairs whose bounds overlap, by brute force */
+int
+storePairsExpected()
+{
+  int a, b, n = 0;
+  Region overlap;
+  for (a = 0; a < N; a++)
+    for (b = a + 1; b < N; b++)
+      if ((store.flags[a] & store.flags[b] & ENTITY_ALIVE) &&
+	  (store.category[a] & store.mask[b]) && (store.category[b] & store.mask[a]) &&
+	  regionIntersect(&overlap, &store.bounds[a], &store.bounds[b]))
+	n++;
+  return n;
+}
+
+int
+main()
+{
+  static const int sizes[] = {8, 32, 64};
+  int r, col = 5;
+  u_char s;
+  for (r = 0; r <= 5; r++) {	/* chords of a circle of radius 5 */
+    while (col * col + r * r > 25)
+      col--;
+    chords5[r] = col;
+  }
+  for (s = 0; s < sizeof sizes / sizeof sizes[0]; s++) {
+    int n = sizes[s], t, i;
+    double storeNs, storeSyncNs, layersNs, start;
+    Layer *layers;
+
+    layerPoolInit(&storePool, 0, 0);
+    entityStoreInit(&store, &storePool);
+    spawnAll(n, 1);
+    layerInit(layerPoolLayers(&storePool));
+    syncNs = 0;
+    start = hostNs();
+    for (t = 0; t < TICKS; t++)
+      storeTick();
+    storeNs = (hostNs() - start) / TICKS;
+    storeSyncNs = syncNs / TICKS;
+    if (entityStoreCollide(&store, entityPairs, 255) != storePairsExpected())
+      bad++;
+    layers = layerPoolLayers(&storePool);
+    layerDraw(layers);
+    for (t = 0; t < 50; t++) {	/* the store's view draws what it holds */
+      storeTick();
+      movLayerDraw(layerPoolMovLayers(&storePool), layers);
+      memcpy(drawn, hostScreen, sizeof drawn);
+      layerDraw(layers);
+      if (memcmp(drawn, hostScreen, sizeof drawn))
+	bad++;
+    }
+
+    layerPoolInit(&pool, 0, 0);
+    bp.count = 0;
+    spawnAll(n, 0);
+    layerInit(layerPoolLayers(&pool));
+    start = hostNs();
+    for (t = 0; t < TICKS; t++) {
+      motionStep(motions, n);
+      for (i = 0; i < n; i++) {
+	Vec2 pos;
+	layerGetPosNext(motions[i].layer, &pos);
+	bounce(&pos, &motions[i].velocity);
+      }
+      broadPhasePairs(&bp, layerPairs, 255);
+      for (i = 0; i < n; i++)	/* as movLayerDraw() would */
+	layerCommitPos(motions[i].layer);
+    }
+    layersNs = (hostNs() - start) / TICKS;
+    printf("benchEntity: %2d entities: store tick %5.0f ns (sync %3.0f), "
+	   "layers with motions & broad phase %5.0f ns\n", n, storeNs, storeSyncNs, layersNs);
+  }
+  printf("benchEntity: %u failed\n", bad);
+  return bad != 0;
+}
@@ -0,0 +1,172 @@
+// Times shapesOverlap() and shapesContact() against checking both
+// layers at every pixel of their overlapping bounds, counts the checks
+// that takes, and compares the first contact, the number of common
+// pixels and their bounding box.
+// Runs on the host, built by the Makefile; times are host ns.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "shape.h"
+
+#define REPS 2000
+
+u_char chords30[31], chords5[6];
+const AbCircle circle30 = {abCircleGetBounds, abCircleCheck, chords30, 30};
+const AbCircle circle5 = {abCircleGetBounds, abCircleCheck, chords5, 5};
+const AbRect rect3 = {abRectGetBounds, abRectCheck, {3,3}};
+const AbRect bar = {abRectGetBounds, abRectCheck, {20,2}};
+const AbRArrow rightArrow = {abRArrowGetBounds, abRArrowCheck, 20};
+const AbRectOutline outline = {abRectOutlineGetBounds, abRectOutlineCheck, {25,25}};
+
+LAYER(aLayer, &circle30, COLOR_RED, 0, 0, 0);
+LAYER(bLayer, &circle30, COLOR_BLUE, 0, 0, 0);
+
+/* pairs of shapes at positions */
+typedef struct {
+  char *name;
+  const AbShape *a, *b;
+  Vec2 aPos, bPos;
+} OverlapCase;
+
+const OverlapCase cases[] = {
+  {"circles, diagonal miss", (const AbShape *)&circle30, (const AbShape *)&circle30,
+   {64, 60}, {107, 103}},
+  {"circles, offset 40", (const AbShape *)&circle30, (const AbShape *)&circle30,
+   {44, 80}, {84, 80}},
+  {"circles, offset 20", (const AbShape *)&circle30, (const AbShape *)&circle30,
+   {54, 80}, {74, 80}},
+  {"small circles", (const AbShape *)&circle5, (const AbShape *)&circle5,
+   {60, 60}, {67, 64}},
+  {"rect in circle", (const AbShape *)&rect3, (const AbShape *)&circle30,
+   {70, 75}, {64, 80}},
+  {"bar across arrow", (const AbShape *)&bar, (const AbShape *)&rightArrow,
+   {64, 70}, {60, 80}},
+  {"circle in outline", (const AbShape *)&circle30, (const AbShape *)&outline,
+   {64, 80}, {64, 80}},
+  {"circle on outline", (const AbShape *)&circle30, (const AbShape *)&outline,
+   {64, 80}, {40, 80}},
+};
+#define N_CASES (sizeof cases / sizeof cases[0])
+
+unsigned long checks;		/* abShapeCheck() calls by the reference */
+
+/** Checks a and b at every pixel of their overlapping bounds, stopping
+ *  at the first common one if first; returns the common pixels and
+ *  stores their first pixel and bounding box in *contact.
+ */
+int
+pixelContact(Layer *a, Layer *b, Region *contact, int first)
+{
+  Region aBounds, bBounds, r;
+  Vec2 pixel;
+  int count = 0;
+  abShapeGetBounds(layerShape(a), &a->pos, &aBounds);
+  abShapeGetBounds(layerShape(b), &b->pos, &bBounds);
+  if (!regionIntersect(&r, &aBounds, &bBounds))
+    return 0;
+  for (pixel.axes[1] = r.topLeft.axes[1]; pixel.axes[1] <= r.botRight.axes[1]; pixel.axes[1]++)
+    for (pixel.axes[0] = r.topLeft.axes[0]; pixel.axes[0] <= r.botRight.axes[0]; pixel.axes[0]++) {
+      checks++;
+      if (!abShapeCheck(layerShape(a), &a->pos, &pixel))
+	continue;
+      checks++;
+      if (!abShapeCheck(layerShape(b), &b->pos, &pixel))
+	continue;
+      if (!count) {
+	contact->topLeft = contact->botRight = pixel;
+	if (first)
+	  return 1;
+      }
+      if (pixel.axes[0] < contact->topLeft.axes[0])
+	contact->topLeft.axes[0] = pixel.axes[0];
+      if (pixel.axes[0] > contact->botRight.axes[0])
+	contact->botRight.axes[0] = pixel.axes[0];
+      contact->botRight.axes[1] = pixel.axes[1];
+      count++;
+    }
+  return count;
+}
+
+/** Host ns since some fixed point */
+double
+hostNs()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/** chords of a circle of radius r */
+void
+circleChords(u_char chords[], int r)
+{
+  int row, col = r;
+  for (row = 0; row <= r; row++) {
+    while (col * col + row * row > r * r)
+      col--;
+    chords[row] = col;
+  }
+}
+
+int
+main()
+{
+  u_int bad = 0;
+  u_char c;
+  circleChords(chords30, 30);
+  circleChords(chords5, 5);
+  for (c = 0; c < N_CASES; c++) {
+    const OverlapCase *oc = &cases[c];
+    Region pixelBox, contactBox;
+    Vec2 contact;
+    int pixelHit, pixelCount, hit, count, i;
+    unsigned long overlapChecks, contactChecks;
+    double start, pixelOverlapNs, pixelContactNs, overlapNs, contactNs;
+
+    aLayer.abShape = (AbShape *)oc->a;
+    aLayer.pos = oc->aPos;
+    bLayer.abShape = (AbShape *)oc->b;
+    bLayer.pos = oc->bPos;
+
+    checks = 0;
+    start = hostNs();
+    for (i = 0; i < REPS; i++)
+      pixelHit = pixelContact(&aLayer, &bLayer, &pixelBox, 1);
+    pixelOverlapNs = (hostNs() - start) / REPS;
+    overlapChecks = checks / REPS;
+    start = hostNs();
+    for (i = 0; i < REPS; i++)
+      hit = shapesOverlap(&aLayer, &bLayer, &contact);
+    overlapNs = (hostNs() - start) / REPS;
+    if (hit != pixelHit || (hit && (contact.axes[0] != pixelBox.topLeft.axes[0] ||
+				    contact.axes[1] != pixelBox.topLeft.axes[1]))) {
+      printf("benchOverlap: %s: shapesOverlap() differs\n", oc->name);
+      bad++;
+    }
+
+    checks = 0;
+    start = hostNs();
+    for (i = 0; i < REPS; i++)
+      pixelCount = pixelContact(&aLayer, &bLayer, &pixelBox, 0);
+    pixelContactNs = (hostNs() - start) / REPS;
+    contactChecks = checks / REPS;
+    start = hostNs();
+    for (i = 0; i < REPS; i++)
+      count = shapesContact(&aLayer, &bLayer, &contactBox);
+    contactNs = (hostNs() - start) / REPS;
+    if (count != pixelCount ||
+	(count && memcmp(&contactBox, &pixelBox, sizeof pixelBox))) {
+      printf("benchOverlap: %s: shapesContact() found %d pixels, not %d\n",
+	     oc->name, count, pixelCount);
+      bad++;
+    }
+
+    printf("benchOverlap: %-22s overlap %5.0f ns (%5.0f, %4lu checks by pixel), "
+	   "contact %5.0f ns (%5.0f, %4lu checks), %d pixels\n", oc->name,
+	   overlapNs, pixelOverlapNs, overlapChecks, contactNs, pixelContactNs,
+	   contactChecks, count);
+  }
+  printf("benchOverlap: %u failed\n", bad);
+  return bad != 0;
+}
@@ -0,0 +1,30 @@
+#include "shape.h"
+#include "shapekernels.h"
+
+// compute bounding box in screen coordinates for bitmap at centerPos
+void
+abBitmapGetBounds(const AbBitmap *bitmap, const Vec2 *centerPos, Region *bounds)
+{
+  bounds->topLeft.axes[0] = centerPos->axes[0] - bitmap->centerCol;
+  bounds->topLeft.axes[1] = centerPos->axes[1] - bitmap->centerRow;
+  bounds->botRight.axes[0] = bounds->topLeft.axes[0] + bitmap->width - 1;
+  bounds->botRight.axes[1] = bounds->topLeft.axes[1] + bitmap->height - 1;
+}
+
+// true if pixel's bit is set in the mask
+int
+abBitmapCheck(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  int col = pixel->axes[0] - centerPos->axes[0] + bitmap->centerCol;
+  int row = pixel->axes[1] - centerPos->axes[1] + bitmap->centerRow;
+  if (col < 0 || col >= bitmap->width || row < 0 || row >= bitmap->height)
+    return 0;
+  return bitmapBit(bitmap->bits + (row << bitmap->rowShift), col) != 0;
+}
+
+// like abBitmapCheck, also returns the last column with the same answer
+int
+abBitmapRun(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return bitmapKernel(bitmap, centerPos, pixel, runEnd);
+}
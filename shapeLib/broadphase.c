@@ -0,0 +1,79 @@
+#include "shape.h"
+
+int
+broadPhaseAdd(BroadPhase *bp, Layer *l, u_char category, u_char mask)
+{
+  BroadEntry *e;
+  if (bp->count == bp->capacity)
+    return 0;
+  e = &bp->entries[bp->count++];	/* sorted in on the next pass */
+  e->layer = l;
+  e->category = category;
+  e->mask = mask;
+  return 1;
+}
+
+int
+broadPhaseRemove(BroadPhase *bp, const Layer *l)
+{
+  u_char i;
+  for (i = 0; i < bp->count; i++)
+    if (bp->entries[i].layer == l) {
+      for (bp->count--; i < bp->count; i++) /* keep the order */
+	bp->entries[i] = bp->entries[i + 1];
+      return 1;
+    }
+  return 0;
+}
+
+/* bounds of l at pos and posNext, and everything between */
+static void
+broadBounds(const Layer *l, Region *bounds)
+{
+  Region next;
+  Vec2 pos;
+  layerGetPos(l, &pos);
+  abShapeGetBounds(layerShape(l), &pos, bounds);
+  layerGetPosNext(l, &pos);
+  abShapeGetBounds(layerShape(l), &pos, &next);
+  regionUnion(bounds, bounds, &next);
+}
+
+u_char
+broadPhasePairs(BroadPhase *bp, LayerPair *pairs, u_char maxPairs)
+{
+  BroadEntry *entries = bp->entries;
+  u_char i, j, n = 0;
+
+  /* insertion sort by left column: objects move a little per tick, so
+     the entries are nearly sorted and this is close to one pass */
+  for (i = 0; i < bp->count; i++) {
+    BroadEntry e = entries[i];
+    broadBounds(e.layer, &e.bounds);
+    for (j = i; j && entries[j - 1].bounds.topLeft.axes[0] > e.bounds.topLeft.axes[0]; j--)
+      entries[j] = entries[j - 1];
+    entries[j] = e;
+  }
+
+  /* entries to the right of a's right column cannot overlap it */
+  for (i = 0; i < bp->count; i++) {
+    const BroadEntry *a = &entries[i];
+    for (j = i + 1; j < bp->count; j++) {
+      const BroadEntry *b = &entries[j];
+      if (b->bounds.topLeft.axes[0] > a->bounds.botRight.axes[0])
+	break;
+      if (!(a->category & b->mask) || !(b->category & a->mask) ||
+	  b->bounds.topLeft.axes[1] > a->bounds.botRight.axes[1] ||
+	  b->bounds.botRight.axes[1] < a->bounds.topLeft.axes[1])
+	continue;
+      if (n == maxPairs)
+	return n;
+      pairs[n].a = a->layer;
+      pairs[n].b = b->layer;
+      pairs[n].aCategory = a->category;
+      pairs[n].bCategory = b->category;
+      n++;
+    }
+  }
+  return n;
+}
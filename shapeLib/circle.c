@@ -1,5 +1,5 @@
 #include "shape.h"
-#include "_abCircle.h"
+#include "shapekernels.h"
 
 // true if pixel is in circle centered at centerPos
 int abCircleCheck(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pixel)
@@ -11,6 +11,13 @@ int abCircleCheck(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pix
   vec2Abs(&relPos);		      /* project to first quadrant */
   return (relPos.axes[0] <= radius && circle->chords[relPos.axes[0]] >= relPos.axes[1]);
 }
+
+// like abCircleCheck, also returns the last column with the same answer
+int
+abCircleRun(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return circleKernel(circle, centerPos, pixel, runEnd);
+}
   
 void
 abCircleGetBounds(const AbCircle *circle, const Vec2 *centerPos, Region *bounds)
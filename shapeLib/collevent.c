@@ -0,0 +1,96 @@
+#include "shape.h"
+
+/* the pair's cooldown entry, or 0 */
+static CollisionCooldown *
+cooldownFind(CollisionRegistry *reg, const Layer *a, const Layer *b)
+{
+  CollisionCooldown *c = reg->cooldowns;
+  u_char i;
+  for (i = reg->nCooldowns; i; i--, c++)
+    if ((c->a == a && c->b == b) || (c->a == b && c->b == a))
+      return c;
+  return 0;
+}
+
+int
+collisionPost(CollisionRegistry *reg, Layer *a, u_char aCategory,
+	      Layer *b, u_char bCategory, const Contact *contact)
+{
+  const CollisionRule *rule = reg->rules;
+  CollisionCooldown *cooling;
+  CollisionEvent *e;
+  char swapped = 0;
+  u_char i;
+
+  for (i = reg->nRules; i; i--, rule++) {
+    if ((aCategory & rule->categoryA) && (bCategory & rule->categoryB))
+      break;
+    if ((bCategory & rule->categoryA) && (aCategory & rule->categoryB)) {
+      swapped = 1;		/* the rule names them the other way round */
+      break;
+    }
+  }
+  if (!i)
+    return 0;			/* nobody cares about this pair */
+
+  cooling = cooldownFind(reg, a, b);
+  if (cooling) {		/* still touching, or not apart for long */
+    cooling->ticks = rule->cooldown + 1;
+    return 0;
+  }
+  if (reg->nEvents == reg->maxEvents) {
+    reg->dropped++;
+    return 0;
+  }
+  if (rule->cooldown && reg->nCooldowns < reg->maxCooldowns) {
+    cooling = &reg->cooldowns[reg->nCooldowns++];
+    cooling->a = a;
+    cooling->b = b;
+    cooling->ticks = rule->cooldown + 1;
+  }
+
+  e = &reg->events[reg->nEvents++];
+  e->rule = rule;
+  e->a = swapped ? b : a;
+  e->b = swapped ? a : b;
+  if (contact)
+    e->contact = *contact;
+  else {
+    e->contact.time = 0;
+    e->contact.normal = vec2Zero;
+  }
+  if (swapped)			/* push the other one out */
+    vec2Sub(&e->contact.normal, &vec2Zero, &e->contact.normal);
+  return 1;
+}
+
+u_char
+collisionDetect(CollisionRegistry *reg, BroadPhase *bp, LayerPair *pairs, u_char maxPairs)
+{
+  u_char i, n = broadPhasePairs(bp, pairs, maxPairs), posted = 0;
+  for (i = 0; i < n; i++) {
+    Contact contact;
+    if (layerSweep(pairs[i].a, pairs[i].b, &contact) &&
+	collisionPost(reg, pairs[i].a, pairs[i].aCategory, pairs[i].b, pairs[i].bCategory,
+		      &contact))
+      posted++;
+  }
+  return posted;
+}
+
+void
+collisionDispatch(CollisionRegistry *reg)
+{
+  CollisionCooldown *c, *kept;
+  u_char i;
+  for (i = 0; i < reg->nEvents; i++) { /* handlers may post more */
+    CollisionEvent *e = &reg->events[i];
+    e->rule->handler(e->a, e->b, &e->contact);
+  }
+  reg->nEvents = 0;
+
+  for (c = kept = reg->cooldowns, i = reg->nCooldowns; i; i--, c++)
+    if (--c->ticks)		/* forget pairs that stayed apart */
+      *kept++ = *c;
+  reg->nCooldowns = kept - reg->cooldowns;
+}
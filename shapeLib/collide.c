@@ -0,0 +1,224 @@
+#include "shape.h"
+
+/* A time as a fraction num / den of a step.  den > 0, or den == 0 for
+   an infinite time whose sign is num's. */
+typedef struct {
+  int num, den;
+} Frac;
+
+/* true if a < b, exactly */
+static int
+fracLess(const Frac *a, const Frac *b)
+{
+  return (long)a->num * b->den < (long)b->num * a->den;
+}
+
+/* times at which a (moving by v) starts and stops overlapping b along
+   one axis; false if it never does */
+static int
+sweepAxis(int aMin, int aMax, int bMin, int bMax, int v, Frac *enter, Frac *exit)
+{
+  if (!v) {			/* overlaps during the whole step, or never */
+    if (aMax < bMin || aMin > bMax)
+      return 0;
+    enter->num = -1; exit->num = 1;
+    enter->den = exit->den = 0;
+  } else if (v > 0) {
+    enter->num = bMin - aMax; exit->num = bMax - aMin;
+    enter->den = exit->den = v;
+  } else {
+    enter->num = aMin - bMax; exit->num = aMax - bMin;
+    enter->den = exit->den = -v;
+  }
+  return 1;
+}
+
+int
+regionSweep(const Region *a, const Vec2 *va, const Region *b, const Vec2 *vb,
+	    Contact *contact)
+{
+  Frac enter[2], exit[2];
+  const Frac *first, *last;
+  u_char axis, hitAxis;
+  Vec2 v;
+  Region overlap;
+
+  vec2Sub(&v, va, vb);		/* b stands still */
+  if (!v.axes[0] && !v.axes[1]) {
+    if (!regionIntersect(&overlap, a, b))
+      return 0;
+    contact->time = 0;
+    contact->normal = vec2Zero;
+    return 1;
+  }
+  for (axis = 0; axis < 2; axis++)
+    if (!sweepAxis(a->topLeft.axes[axis], a->botRight.axes[axis],
+		   b->topLeft.axes[axis], b->botRight.axes[axis],
+		   v.axes[axis], &enter[axis], &exit[axis]))
+      return 0;
+  hitAxis = fracLess(&enter[0], &enter[1]); /* overlapping on both axes begins */
+  first = &enter[hitAxis];
+  last = fracLess(&exit[0], &exit[1]) ? &exit[0] : &exit[1];
+  if (fracLess(last, first) ||	/* never on both axes at once */
+      first->num > first->den ||	/* after this step */
+      last->num < 0)		/* before it */
+    return 0;
+
+  contact->normal = vec2Zero;
+  if (first->num < 0)		/* already overlapping */
+    contact->time = 0;
+  else {
+    contact->time = ((long)first->num << COLLIDE_SHIFT) / first->den;
+    contact->normal.axes[hitAxis] = v.axes[hitAxis] > 0 ? -1 : 1;
+  }
+  return 1;
+}
+
+/* bounds of l at pos, and its motion to posNext */
+static void
+layerSweepBounds(const Layer *l, Region *bounds, Vec2 *motion)
+{
+  Vec2 pos, posNext;
+  layerGetPos(l, &pos);
+  layerGetPosNext(l, &posNext);
+  abShapeGetBounds(layerShape(l), &pos, bounds);
+  vec2Sub(motion, &posNext, &pos);
+}
+
+int
+layerSweep(const Layer *a, const Layer *b, Contact *contact)
+{
+  Region aBounds, bBounds;
+  Vec2 va, vb;
+  layerSweepBounds(a, &aBounds, &va);
+  layerSweepBounds(b, &bBounds, &vb);
+  return regionSweep(&aBounds, &va, &bBounds, &vb, contact);
+}
+
+/* stores a hit, keeping hits sorted by time; drops the latest if full */
+static u_char
+collideAdd(CollideHit *hits, u_char n, u_char maxHits, Layer *a, Layer *b,
+	   const Contact *contact)
+{
+  u_char i;
+  if (n == maxHits) {
+    if (!n || hits[n - 1].contact.time <= contact->time)
+      return n;
+    n--;			/* make room: drop the latest */
+  }
+  for (i = n; i && hits[i - 1].contact.time > contact->time; i--)
+    hits[i] = hits[i - 1];
+  hits[i].a = a;
+  hits[i].b = b;
+  hits[i].contact = *contact;
+  return n + 1;
+}
+
+u_char
+collideLayers(MovLayer *movLayers, Layer *statics, CollideHit *hits, u_char maxHits)
+{
+  MovLayer *ml, *other;
+  u_char n = 0;
+  for (ml = movLayers; ml; ml = movLayerNext(ml)) {
+    Layer *a = movLayerLayer(ml), *b;
+    Contact contact;
+    for (other = movLayerNext(ml); other; other = movLayerNext(other)) {
+      b = movLayerLayer(other);
+      if (layerSweep(a, b, &contact))
+	n = collideAdd(hits, n, maxHits, a, b, &contact);
+    }
+    for (b = statics; b; b = layerNext(b))
+      if (layerSweep(a, b, &contact))
+	n = collideAdd(hits, n, maxHits, a, b, &contact);
+  }
+  return n;
+}
+
+/* distance from c to lo..hi, 0 if within; *side is -1 before, 1 after */
+static int
+axisGap(int c, int lo, int hi, int *side)
+{
+  *side = (c < lo) ? -1 : 1;
+  if (c < lo)
+    return lo - c;
+  return (c > hi) ? c - hi : 0;
+}
+
+int
+circleRectOverlap(const AbCircle *circle, const Vec2 *circlePos, const Region *rect,
+		  Penetration *pen)
+{
+  const u_char *chords = circle->chords;
+  u_char radius = circle->radius;
+  int colSide, rowSide, col, depth;
+  int dCol = axisGap(circlePos->axes[0], rect->topLeft.axes[0], rect->botRight.axes[0], &colSide);
+  int dRow = axisGap(circlePos->axes[1], rect->topLeft.axes[1], rect->botRight.axes[1], &rowSide);
+  if (dCol > radius || chords[dCol] < dRow)
+    return 0;			/* the column nearest the center misses */
+  if (!pen)
+    return 1;
+
+  pen->normal = vec2Zero;
+  if (!dCol && !dRow) {		/* center inside: leave by the nearest edge */
+    int d;
+    pen->depth = circlePos->axes[0] + radius - rect->topLeft.axes[0] + 1;
+    pen->normal.axes[0] = -1;
+    d = rect->botRight.axes[0] - circlePos->axes[0] + radius + 1;
+    if (d < pen->depth) {
+      pen->depth = d;
+      pen->normal.axes[0] = 1;
+    }
+    d = circlePos->axes[1] + chords[0] - rect->topLeft.axes[1] + 1;
+    if (d < pen->depth) {
+      pen->depth = d;
+      pen->normal.axes[0] = 0;
+      pen->normal.axes[1] = -1;
+    }
+    d = rect->botRight.axes[1] - circlePos->axes[1] + chords[0] + 1;
+    if (d < pen->depth) {
+      pen->depth = d;
+      pen->normal.axes[0] = 0;
+      pen->normal.axes[1] = 1;
+    }
+    return 1;
+  }
+  if (!dRow) {			/* beside it: the widest row is inside */
+    pen->depth = radius - dCol + 1;
+    pen->normal.axes[0] = colSide;
+    return 1;
+  }
+  depth = chords[dCol] - dRow + 1;	/* above or below it */
+  if (dCol) {			/* at a corner: sideways if shallower */
+    for (col = dCol; col < radius && col - dCol + 1 < depth && chords[col + 1] >= dRow; col++)
+      ;
+    if (col - dCol + 1 < depth) {
+      pen->depth = col - dCol + 1;
+      pen->normal.axes[0] = colSide;
+      return 1;
+    }
+  }
+  pen->depth = depth;
+  pen->normal.axes[1] = rowSide;
+  return 1;
+}
+
+int
+circlesOverlap(const CirclePair *pair, const Vec2 *aPos, const Vec2 *bPos, Penetration *pen)
+{
+  int colSide, rowSide;
+  int dCol = axisGap(aPos->axes[0], bPos->axes[0], bPos->axes[0], &colSide);
+  int dRow = axisGap(aPos->axes[1], bPos->axes[1], bPos->axes[1], &rowSide);
+  if (dCol > pair->radius || pair->chords[dCol] < dRow)
+    return 0;
+  if (pen) {
+    pen->normal = vec2Zero;
+    if (dCol > dRow) {
+      pen->depth = pair->rowChords[dRow] - dCol + 1;
+      pen->normal.axes[0] = colSide;
+    } else {
+      pen->depth = pair->chords[dCol] - dRow + 1;
+      pen->normal.axes[1] = rowSide;
+    }
+  }
+  return 1;
+}
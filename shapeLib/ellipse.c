@@ -0,0 +1,62 @@
+#include "shape.h"
+#include "shapekernels.h"
+
+// true if pixel is in ellipse centered at centerPos
+int
+abEllipseCheck(const AbEllipse *ellipse, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Vec2 relPos;
+  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
+  vec2Abs(&relPos);		      /* project to first quadrant */
+  return (relPos.axes[1] <= ellipse->rowRadius &&
+	  relPos.axes[0] <= ellipse->chords[relPos.axes[1]]);
+}
+
+// like abEllipseCheck, also returns the last column with the same answer
+int
+abEllipseRun(const AbEllipse *ellipse, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return ellipseKernel(ellipse, centerPos, pixel, runEnd);
+}
+
+void
+abEllipseGetBounds(const AbEllipse *ellipse, const Vec2 *centerPos, Region *bounds)
+{
+  bounds->topLeft.axes[0] = centerPos->axes[0] - ellipse->colRadius;
+  bounds->topLeft.axes[1] = centerPos->axes[1] - ellipse->rowRadius;
+  bounds->botRight.axes[0] = centerPos->axes[0] + ellipse->colRadius;
+  bounds->botRight.axes[1] = centerPos->axes[1] + ellipse->rowRadius;
+  regionClipScreen(bounds);
+}
+
+// true if pixel is in the outer disc but not in the inner one
+int
+abAnnulusCheck(const AbAnnulus *annulus, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Vec2 relPos;
+  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
+  vec2Abs(&relPos);		      /* project to first quadrant */
+  if (relPos.axes[1] > annulus->outerRadius ||
+      relPos.axes[0] > annulus->outer[relPos.axes[1]])
+    return 0;			/* outside */
+  return (relPos.axes[1] > annulus->innerRadius ||
+	  relPos.axes[0] > annulus->inner[relPos.axes[1]]);
+}
+
+// like abAnnulusCheck, also returns the last column with the same answer
+int
+abAnnulusRun(const AbAnnulus *annulus, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return annulusKernel(annulus, centerPos, pixel, runEnd);
+}
+
+void
+abAnnulusGetBounds(const AbAnnulus *annulus, const Vec2 *centerPos, Region *bounds)
+{
+  u_char colRadius = annulus->outer[0], rowRadius = annulus->outerRadius;
+  bounds->topLeft.axes[0] = centerPos->axes[0] - colRadius;
+  bounds->topLeft.axes[1] = centerPos->axes[1] - rowRadius;
+  bounds->botRight.axes[0] = centerPos->axes[0] + colRadius;
+  bounds->botRight.axes[1] = centerPos->axes[1] + rowRadius;
+  regionClipScreen(bounds);
+}
@@ -0,0 +1,157 @@
+#include "shape.h"
+
+void
+entityStoreInit(EntityStore *es, LayerPool *pool)
+{
+  u_char i;
+  for (i = 0; i < es->capacity; i++)
+    es->flags[i] = 0;
+  es->nMoving = es->nColliding = 0;
+  es->pool = pool;
+}
+
+u_char
+entitySpawn(EntityStore *es, u_char shape, LayerColor color, u_char flags,
+	    u_char category, u_char mask, const Vec2 *pos, const Vec2 *velocity)
+{
+  const AbShape *s = es->shapes[shape];
+  Region bounds;
+  u_char id;
+  for (id = 0; id < es->capacity && (es->flags[id] & ENTITY_ALIVE); id++)
+    ;
+  if (id == es->capacity)
+    return ENTITY_NONE;
+  if (flags & ENTITY_VISIBLE) {
+    es->layer[id] = layerPoolSpawn(es->pool, s, color, pos, &vec2Zero);
+    if (es->layer[id] == LAYER_HANDLE_NONE)
+      return ENTITY_NONE;
+  }
+
+  es->pos[id] = *pos;
+  es->velocity[id] = *velocity;
+  es->frac[id][0] = es->frac[id][1] = 0;
+  /* measured at the screen's center: some shapes clip their bounds to it */
+  abShapeGetBounds(s, &screenCenter, &bounds);
+  vec2Sub(&bounds.topLeft, &bounds.topLeft, &screenCenter);
+  vec2Sub(&bounds.botRight, &bounds.botRight, &screenCenter);
+  vec2Add(&es->bounds[id].topLeft, &bounds.topLeft, pos);
+  vec2Add(&es->bounds[id].botRight, &bounds.botRight, pos);
+  es->shape[id] = shape;
+  es->color[id] = color;
+  es->flags[id] = (flags & ~ENTITY_MOVED) | ENTITY_ALIVE;
+  es->category[id] = category;
+  es->mask[id] = mask;
+  if (flags & ENTITY_MOVES)
+    es->moving[es->nMoving++] = id;
+  if (flags & ENTITY_COLLIDES)
+    es->colliding[es->nColliding++] = id;
+  return id;
+}
+
+/* removes id from the list of n ids */
+static void
+entityListRemove(u_char *list, u_char *n, u_char id)
+{
+  u_char i;
+  for (i = 0; i < *n; i++)
+    if (list[i] == id) {
+      for ((*n)--; i < *n; i++)	/* keep the order */
+	list[i] = list[i + 1];
+      return;
+    }
+}
+
+void
+entityDespawn(EntityStore *es, u_char id)
+{
+  u_char flags = es->flags[id];
+  if (!(flags & ENTITY_ALIVE))
+    return;
+  if (flags & ENTITY_MOVES)
+    entityListRemove(es->moving, &es->nMoving, id);
+  if (flags & ENTITY_COLLIDES)
+    entityListRemove(es->colliding, &es->nColliding, id);
+  if (flags & ENTITY_VISIBLE)
+    layerPoolDespawn(es->pool, es->layer[id]);
+  es->flags[id] = 0;
+}
+
+u_char
+entityStoreStep(EntityStore *es)
+{
+  const u_char *id = es->moving;
+  u_char n, moved = 0;
+  for (n = es->nMoving; n; n--, id++) {
+    u_char e = *id, axis;
+    char changed = 0;
+    for (axis = 0; axis < 2; axis++) {
+      int sum = es->frac[e][axis] + es->velocity[e].axes[axis];
+      int d = sum >> FIX_SHIFT;	/* whole pixels, rounded down */
+      es->frac[e][axis] = sum;
+      if (d) {
+	es->pos[e].axes[axis] += d;
+	es->bounds[e].topLeft.axes[axis] += d;
+	es->bounds[e].botRight.axes[axis] += d;
+	changed = 1;
+      }
+    }
+    if (changed) {
+      es->flags[e] |= ENTITY_MOVED;
+      moved++;
+    }
+  }
+  return moved;
+}
+
+u_char
+entityStoreCollide(EntityStore *es, EntityPair *pairs, u_char maxPairs)
+{
+  u_char *ids = es->colliding;
+  const Region *bounds = es->bounds;
+  u_char i, j, n = 0;
+
+  /* insertion sort of the ids by left column: nearly sorted already */
+  for (i = 1; i < es->nColliding; i++) {
+    u_char e = ids[i];
+    int left = bounds[e].topLeft.axes[0];
+    for (j = i; j && bounds[ids[j - 1]].topLeft.axes[0] > left; j--)
+      ids[j] = ids[j - 1];
+    ids[j] = e;
+  }
+
+  for (i = 0; i < es->nColliding; i++) {
+    u_char a = ids[i];
+    const Region *ra = &bounds[a];
+    for (j = i + 1; j < es->nColliding; j++) {
+      u_char b = ids[j];
+      const Region *rb = &bounds[b];
+      if (rb->topLeft.axes[0] > ra->botRight.axes[0])
+	break;			/* and so do all the rest */
+      if (!(es->category[a] & es->mask[b]) || !(es->category[b] & es->mask[a]) ||
+	  rb->topLeft.axes[1] > ra->botRight.axes[1] ||
+	  rb->botRight.axes[1] < ra->topLeft.axes[1])
+	continue;
+      if (n == maxPairs)
+	return n;
+      pairs[n].a = a;
+      pairs[n].b = b;
+      n++;
+    }
+  }
+  return n;
+}
+
+void
+entityStoreSync(EntityStore *es)
+{
+  const u_char *id = es->moving;
+  u_char n;
+  for (n = es->nMoving; n; n--, id++) {
+    u_char e = *id;
+    if (!(es->flags[e] & ENTITY_MOVED))
+      continue;
+    es->flags[e] &= ~ENTITY_MOVED;
+    if (es->flags[e] & ENTITY_VISIBLE)
+      layerSetPosNext(layerPoolLayer(es->pool, es->layer[e]), &es->pos[e]);
+  }
+}
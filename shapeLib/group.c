@@ -0,0 +1,114 @@
+#include "shape.h"
+
+/* position of child when group is drawn at centerPos */
+static void
+groupChildPos(const Layer *child, const Vec2 *centerPos, Vec2 *pos)
+{
+  layerGetPos(child, pos);
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+  pos->axes[0] = (signed char)pos->axes[0]; /* offsets, not coordinates */
+  pos->axes[1] = (signed char)pos->axes[1];
+#endif
+  vec2Add(pos, pos, centerPos);
+}
+
+/* computes the children's bounds, relative to the group, once */
+static void
+groupPrepare(const AbGroup *group)
+{
+  GroupState *state = group->state;
+  Layer *child;
+  if (state->boundsValid)
+    return;
+  for (child = group->children; child; child = layerNext(child)) {
+    Region childBounds;
+    Vec2 pos;
+    groupChildPos(child, &screenCenter, &pos);
+    abShapeGetBounds(layerShape(child), &pos, &childBounds);
+    if (child == group->children)
+      state->bounds = childBounds;
+    else
+      regionUnion(&state->bounds, &state->bounds, &childBounds);
+  }
+  if (!group->children)
+    state->bounds.topLeft = state->bounds.botRight = screenCenter;
+  vec2Sub(&state->bounds.topLeft, &state->bounds.topLeft, &screenCenter);
+  vec2Sub(&state->bounds.botRight, &state->bounds.botRight, &screenCenter);
+  state->boundsValid = 1;
+}
+
+void
+abGroupChanged(const AbGroup *group)
+{
+  group->state->boundsValid = 0;
+}
+
+void
+abGroupGetBounds(const AbGroup *group, const Vec2 *centerPos, Region *bounds)
+{
+  groupPrepare(group);
+  vec2Add(&bounds->topLeft, &group->state->bounds.topLeft, centerPos);
+  vec2Add(&bounds->botRight, &group->state->bounds.botRight, centerPos);
+}
+
+/* records child as the group's hit (or the child it hit, if a group) */
+static void
+groupHit(const AbGroup *group, Layer *child)
+{
+  group->state->hit = layerHit(child);
+}
+
+int
+abGroupCheck(const AbGroup *group, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Layer *child;
+  for (child = group->children; child; child = layerNext(child)) {
+    Vec2 pos;
+    groupChildPos(child, centerPos, &pos);
+    if (abShapeCheck(layerShape(child), &pos, pixel)) {
+      groupHit(group, child);
+      return 1;
+    }
+  }
+  group->state->hit = 0;
+  return 0;
+}
+
+int
+abGroupRun(const AbGroup *group, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  const Region *bounds;
+  int col = pixel->axes[0] - centerPos->axes[0];
+  int row = pixel->axes[1] - centerPos->axes[1];
+  int end = RUN_END_MAX;
+  Layer *child;
+
+  groupPrepare(group);
+  bounds = &group->state->bounds;
+  group->state->hit = 0;
+  if (row < bounds->topLeft.axes[1] || row > bounds->botRight.axes[1] ||
+      col > bounds->botRight.axes[0]) {
+    *runEnd = RUN_END_MAX;	/* whole group rejected */
+    return 0;
+  }
+  if (col < bounds->topLeft.axes[0]) {
+    *runEnd = pixel->axes[0] + bounds->topLeft.axes[0] - col - 1;
+    return 0;
+  }
+  /* the answer holds until the first change among the children
+     probed, as the compositor does for layers */
+  for (child = group->children; child; child = layerNext(child)) {
+    Vec2 pos;
+    int childEnd;
+    groupChildPos(child, centerPos, &pos);
+    if (abShapeRun(layerShape(child), &pos, pixel, &childEnd)) {
+      groupHit(group, child);
+      *runEnd = childEnd < end ? childEnd : end;
+      return 1;
+    }
+    if (childEnd < end)
+      end = childEnd;
+  }
+  *runEnd = end;
+  return 0;
+}
@@ -0,0 +1,36 @@
+// Host stand-ins for lcdutils.c and libTimer's status register routines,
+// so that host tests can draw layers.  See hostLcd.h.
+
+#include "hostLcd.h"
+#include "libTimer.h"
+
+u_int hostScreen[screenHeight][screenWidth];
+long hostLcdBytes;
+
+u_int bgColor = COLOR_WHITE;	/* the host tests are the application */
+
+static u_char colStart, rowStart, colEnd, rowEnd, col, row;
+
+void
+lcd_setArea(u_char cs, u_char rs, u_char ce, u_char re)
+{
+  colStart = col = cs; rowStart = row = rs;
+  colEnd = ce; rowEnd = re;
+  hostLcdBytes += 11;		/* CASET + 4, PASET + 4, RAMWR */
+}
+
+void
+lcd_writeColor(u_int colorBGR)
+{
+  if (col < screenWidth && row < screenHeight)
+    hostScreen[row][col] = colorBGR;
+  hostLcdBytes += 2;
+  if (++col > colEnd) {		/* the LCD wraps within the area */
+    col = colStart;
+    if (++row > rowEnd)
+      row = rowStart;
+  }
+}
+
+void or_sr(int or_val) {}
+void and_sr(int and_val) {}
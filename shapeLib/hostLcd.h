@@ -0,0 +1,14 @@
+#ifndef hostLcd_included
+#define hostLcd_included
+
+#include "lcdutils.h"
+
+/** Host stand-in for the LCD (hostLcd.c), for the host tests
+ *
+ *  lcd_setArea() and lcd_writeColor() draw into hostScreen and count the
+ *  bytes they would send over SPI in hostLcdBytes.
+ */
+extern u_int hostScreen[screenHeight][screenWidth];
+extern long hostLcdBytes;
+
+#endif // included
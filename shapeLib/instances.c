@@ -0,0 +1,136 @@
+#include "shape.h"
+
+/* center of instance i when drawn at centerPos */
+static void
+instanceCenter(const AbInstances *inst, u_char i, const Vec2 *centerPos, Vec2 *center)
+{
+  center->axes[0] = centerPos->axes[0] + inst->positions[i].col;
+  center->axes[1] = centerPos->axes[1] + inst->positions[i].row;
+}
+
+void
+abInstancesGetBounds(const AbInstances *inst, const Vec2 *centerPos, Region *bounds)
+{
+  u_char i;
+  bounds->topLeft = bounds->botRight = *centerPos;
+  for (i = 0; i < inst->list->count; i++) {
+    Vec2 center;
+    Region instBounds;
+    instanceCenter(inst, i, centerPos, &center);
+    abShapeGetBounds(inst->abShape, &center, &instBounds);
+    if (i)
+      regionUnion(bounds, bounds, &instBounds);
+    else
+      *bounds = instBounds;
+  }
+}
+
+int
+abInstancesCheck(const AbInstances *inst, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  u_char i;
+  for (i = 0; i < inst->list->count; i++) {
+    Vec2 center;
+    instanceCenter(inst, i, centerPos, &center);
+    if (abShapeCheck(inst->abShape, &center, pixel))
+      return 1;
+  }
+  return 0;
+}
+
+void
+abInstancesMoved(const AbInstances *inst)
+{
+  inst->list->sorted = 0;
+}
+
+/* sorts order by row.  Insertion sort: positions are usually declared
+   row by row already. */
+static void
+instancesSort(const AbInstances *inst)
+{
+  InstanceList *list = inst->list;
+  u_char i, j;
+  for (i = 0; i < list->count; i++)
+    list->order[i] = i;
+  for (i = 1; i < list->count; i++) {
+    u_char row = inst->positions[i].row;
+    for (j = i; j && inst->positions[list->order[j-1]].row > row; j--)
+      list->order[j] = list->order[j-1];
+    list->order[j] = i;
+  }
+  list->sorted = 1;
+}
+
+/* updates list->active for row, dropping instances above it and
+   inserting those that start on or before it in column order */
+static void
+instancesRow(const AbInstances *inst, const Vec2 *centerPos, int row)
+{
+  InstanceList *list = inst->list;
+  u_char i, j;
+  int top, bottom;
+  if (list->sorted && row == list->row &&
+      centerPos->axes[0] == list->centerPos.axes[0] &&
+      centerPos->axes[1] == list->centerPos.axes[1])
+    return;			/* already listed */
+  if (!list->sorted || row < list->row ||
+      centerPos->axes[0] != list->centerPos.axes[0] ||
+      centerPos->axes[1] != list->centerPos.axes[1]) {
+    if (!list->sorted)
+      instancesSort(inst);
+    /* measured at the screen's center: some shapes clip their bounds to it */
+    abShapeGetBounds(inst->abShape, &screenCenter, &list->shapeBounds);
+    vec2Sub(&list->shapeBounds.topLeft, &list->shapeBounds.topLeft, &screenCenter);
+    vec2Sub(&list->shapeBounds.botRight, &list->shapeBounds.botRight, &screenCenter);
+    list->activeCount = list->nextOrder = 0;
+    list->centerPos = *centerPos;
+  }
+  list->row = row;
+  top = centerPos->axes[1] + list->shapeBounds.topLeft.axes[1];
+  bottom = centerPos->axes[1] + list->shapeBounds.botRight.axes[1];
+
+  for (i = j = 0; i < list->activeCount; i++) /* drop instances above row */
+    if (bottom + inst->positions[list->active[i]].row >= row)
+      list->active[j++] = list->active[i];
+  list->activeCount = j;
+
+  for (; list->nextOrder < list->count; list->nextOrder++) {
+    u_char idx = list->order[list->nextOrder];
+    const InstancePos *p = &inst->positions[idx];
+    if (top + p->row > row)
+      break;			/* later instances start below row */
+    if (bottom + p->row < row)
+      continue;			/* already above row */
+    for (j = list->activeCount; j && inst->positions[list->active[j-1]].col > p->col; j--)
+      list->active[j] = list->active[j-1];
+    list->active[j] = idx;
+    list->activeCount++;
+  }
+}
+
+int
+abInstancesRun(const AbInstances *inst, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  InstanceList *list = inst->list;
+  int end = RUN_END_MAX, left;
+  u_char i;
+  instancesRow(inst, centerPos, pixel->axes[1]);
+  left = centerPos->axes[0] + list->shapeBounds.topLeft.axes[0];
+  for (i = 0; i < list->activeCount; i++) {
+    u_char idx = list->active[i];
+    Vec2 center;
+    int instEnd;
+    if (left + inst->positions[idx].col > end)
+      break;			/* this & later instances start after the run */
+    instanceCenter(inst, idx, centerPos, &center);
+    if (abShapeRun(inst->abShape, &center, pixel, &instEnd)) {
+      *runEnd = instEnd;
+      return 1;
+    }
+    if (instEnd < end)
+      end = instEnd;
+  }
+  *runEnd = end;
+  return 0;
+}
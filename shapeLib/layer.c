@@ -1,36 +1,179 @@
 #include "lcdutils.h"
 #include "lcddraw.h"
 #include "shape.h"
+#include "shapekernels.h"
 
-void
-layerDraw(Layer *layers)
+/** Clips region to the last addressable pixel of the screen.
+ *  Returns false if nothing remains on screen.
+ */
+static int
+layerClip(Region *r, const Region *region)
+{
+  r->topLeft = region->topLeft;
+  vec2Max(&r->topLeft, &r->topLeft, &vec2Zero);
+  r->botRight.axes[0] = region->botRight.axes[0] < screenWidth ? 
+    region->botRight.axes[0] : screenWidth - 1;
+  r->botRight.axes[1] = region->botRight.axes[1] < screenHeight ? 
+    region->botRight.axes[1] : screenHeight - 1;
+  return (r->topLeft.axes[0] <= r->botRight.axes[0] &&
+	  r->topLeft.axes[1] <= r->botRight.axes[1]);
+}
+
+#ifndef LAYER_PROBES_MAX
+#define LAYER_PROBES_MAX 8	/* layers probed through their kernels, from the top */
+#endif
+
+/** What the compositor keeps about one layer while drawing */
+typedef struct {
+  const AbShape *abShape;
+  Vec2 pos;
+  int runEnd;			/* last column of the current run */
+  u_char kind;			/* SHAPE_USER: use layerRun() */
+  char covered;
+} LayerProbe;
+
+/** Probes layer l at pixel, calling its shape's kernel directly */
+static inline int
+layerProbeRun(Layer *l, LayerProbe *p, const Vec2 *pixel)
+{
+  switch (p->kind) {
+#define SHAPE_KIND_CASE(kind, type, check, kernel)			\
+  case kind: return kernel((const type *)p->abShape, &p->pos, pixel, &p->runEnd);
+  SHAPE_KINDS(SHAPE_KIND_CASE)
+#undef SHAPE_KIND_CASE
+  }
+  return layerRun(l, pixel, &p->runEnd); /* baked, cached or user shape */
+}
+
+/** Renders rows rowStart..rowEnd of the clipped region r.
+ *
+ *  Each layer reports how far its answer holds along the row, so the
+ *  pixels up to the nearest change among the layers probed share one
+ *  color and are written without probing them again.  Shape kinds are
+ *  looked up once, so the inner loop switches on them instead of
+ *  calling through check pointers.
+ */
+static void
+layerDrawRows(Layer *layers, const Region *r, int rowStart, int rowEnd)
 {
   int row, col;
-  for (row = 0; row < screenHeight; row++) {
-    lcd_setArea(0, row, screenWidth-1, row);
-    for (col = 0; col < screenWidth; col++) {
+  LayerProbe probes[LAYER_PROBES_MAX];
+  u_char nProbes;
+  Layer *probeLayer, *lastHit = 0;
+  u_int color = bgColor;
+  layerBakeRefresh(layers);
+  shapeCacheTick();
+  for (probeLayer = layers, nProbes = 0; probeLayer && nProbes < LAYER_PROBES_MAX;
+       probeLayer = layerNext(probeLayer), nProbes++) {
+    LayerProbe *p = &probes[nProbes];
+    LayerBake *bake = layerBakeOf(probeLayer);
+    p->abShape = layerShape(probeLayer);
+    layerGetPos(probeLayer, &p->pos);
+    if ((bake && bake->valid) || (shapeCache && shapeCacheHas(shapeCache, p->abShape)))
+      p->kind = SHAPE_USER;
+    else
+      p->kind = abShapeKind(p->abShape);
+  }
+  lcd_setArea(r->topLeft.axes[0], rowStart, r->botRight.axes[0], rowEnd);
+  for (row = rowStart; row <= rowEnd; row++) {
+    TileCursor tiles;
+    u_char i;
+    for (i = 0; i < nProbes; i++)
+      probes[i].runEnd = -1;
+    if (tileMap)
+      tileMapRow(tileMap, row, &tiles);
+    for (col = r->topLeft.axes[0]; col <= r->botRight.axes[0]; ) {
       Vec2 pixelPos = {col, row};
-      u_int color = bgColor;
-      Layer *probeLayer;
-      for (probeLayer = layers; probeLayer; probeLayer = probeLayer->next) {
-	if (abShapeCheck(probeLayer->abShape, &probeLayer->pos, &pixelPos)) {
-	  color = probeLayer->color;
-	  break; 
-	} /* if check */
-      } // for checking all layers at col, row
-      lcd_writeColor(color); 
+      Layer *hit = 0;
+      int end = r->botRight.axes[0];
+      for (probeLayer = layers, i = 0; probeLayer; probeLayer = layerNext(probeLayer), i++) {
+	int probeCovered, probeEnd;
+	if (i < nProbes) {
+	  LayerProbe *p = &probes[i];
+	  if (p->runEnd < col)	/* run ended: probe again */
+	    p->covered = layerProbeRun(probeLayer, p, &pixelPos);
+	  probeCovered = p->covered;
+	  probeEnd = p->runEnd;
+	} else {
+	  probeCovered = layerCheck(probeLayer, &pixelPos);
+	  probeEnd = col;
+	}
+	if (probeEnd < end)
+	  end = probeEnd;
+	if (probeCovered) {
+	  hit = layerHit(probeLayer); /* a group's child has the color */
+	  break;
+	}
+      } // for checking all layers at pixel
+      if (!hit && tileMap) {	/* background tiles */
+	tileMapWrite(&tiles, col, end);
+	col = end + 1;
+	continue;
+      }
+      if (hit != lastHit) {	/* resolve the color once per run */
+	color = hit ? layerColorBGR(layerColor(hit)) : bgColor;
+	lastHit = hit;
+      }
+      for (; col <= end; col++)
+	lcd_writeColor(color);
     } // for col
   } // for row
+}
+
+void
+layerDrawRegion(Layer *layers, const Region *region)
+{
+  Region r;
+  if (layerClip(&r, region))
+    layerDrawRows(layers, &r, r.topLeft.axes[1], r.botRight.axes[1]);
 } 
 
+void
+layerDraw(Layer *layers)
+{
+  Region screen = {{0, 0}, {screenWidth-1, screenHeight-1}};
+  layerDrawRegion(layers, &screen);
+} 
+
+void
+layerDrawBegin(LayerDrawJob *job, Layer *layers, const Region *region)
+{
+  job->layers = layers;
+  if (layerClip(&job->region, region)) {
+    job->row = job->region.topLeft.axes[1];
+    job->rowsLeft = job->region.botRight.axes[1] - job->row + 1;
+  } else
+    job->rowsLeft = 0;		/* nothing on screen: already done */
+}
 
+int
+layerDrawStep(LayerDrawJob *job, int rows)
+{
+  if (rows > job->rowsLeft)
+    rows = job->rowsLeft;
+  if (rows > 0) {
+    layerDrawRows(job->layers, &job->region, job->row, job->row + rows - 1);
+    job->row += rows;
+    job->rowsLeft -= rows;
+  }
+  return layerDrawDone(job);
+}
+
+int
+layerDrawDone(const LayerDrawJob *job)
+{
+  return job->rowsLeft == 0;
+}
 
 void
 layerGetBounds(const Layer *l, Region *bounds)
 {
   Region lastBounds, curBounds;
-  abShapeGetBounds(l->abShape, &l->posLast, &lastBounds);
-  abShapeGetBounds(l->abShape, &l->pos, &curBounds);
+  Vec2 pos, posLast;
+  layerGetPos(l, &pos);
+  layerGetPosLast(l, &posLast);
+  abShapeGetBounds(layerShape(l), &posLast, &lastBounds);
+  abShapeGetBounds(layerShape(l), &pos, &curBounds);
   regionUnion(bounds, &curBounds, &lastBounds);
   regionClipScreen(bounds);
 }
@@ -38,7 +181,35 @@ layerGetBounds(const Layer *l, Region *bounds)
 void
 layerInit(Layer *layer)
 {
-  for (; layer; layer = layer->next)
+  for (; layer; layer = layerNext(layer)) {
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+    layer->lastCol = layer->lastRow = layer->nextCol = layer->nextRow = 0;
+#else
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+    layer->pos = layer->desc->posInit;
+#endif
     layer->posLast = layer->posNext = layer->pos;
+#endif
+    if ((void *)layerShape(layer)->check == (void *)abGroupCheck) {
+      const AbGroup *group = (const AbGroup *)layerShape(layer);
+      layerInit(group->children);
+      abGroupChanged(group);
+    }
+  }
+}
+
+void
+layerCommitPos(Layer *l)
+{
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+  l->col += l->nextCol;		/* posNext becomes pos */
+  l->row += l->nextRow;
+  l->lastCol = -l->nextCol;	/* old pos, relative to the new one */
+  l->lastRow = -l->nextRow;
+  l->nextCol = l->nextRow = 0;
+#else
+  l->posLast = l->pos;
+  l->pos = l->posNext;
+#endif
 }
 
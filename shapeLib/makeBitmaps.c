@@ -0,0 +1,167 @@
+// Generate AbBitmaps from the check functions of other AbShapes.
+// Runs on the host, built by the Makefile with $(HOST_SOURCES)
+
+#include <stdio.h>
+#include <assert.h>
+#include "shape.h"
+
+#define BITMAP_BYTES_MAX 4096
+
+// like abRectCheck, but excludes a triangle (from shapedemo3.c)
+int
+abSlicedRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Vec2 relPos;
+  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
+  if (relPos.axes[0] >= 0 && relPos.axes[0]/2 < relPos.axes[1])
+    return 0;
+  else
+    return abRectCheck(rect, centerPos, pixel);
+}
+
+// the "P" of game/myShape.c, pixel for pixel
+int
+abPCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Vec2 relPos;
+  vec2Sub(&relPos, pixel, centerPos); /* vector from center to pixel */
+  /* myShape.c writes "relPos.axes[0]/2 >= 0 < relPos.axes[1]", which C
+     parses as below: the slice is col >= -1 && row >= 2 */
+  if (relPos.axes[0]/2 >= 0 && (relPos.axes[0]/2 >= 0) < relPos.axes[1])
+    return 0;
+  else
+    return abRectCheck(rect, centerPos, pixel);
+}
+
+const AbRect slicedRect10 = {abRectGetBounds, abSlicedRectCheck, 10,10};
+const AbRect rectP = {abRectGetBounds, abPCheck, 10,20};
+const AbRArrow rightArrow30 = {abRArrowGetBounds, abRArrowCheck, 30};
+
+struct {
+  char *name;
+  const AbShape *shape;
+} sources[] = {
+  {"bitmapSlicedRect10", (const AbShape *)&slicedRect10},
+  {"bitmapP", (const AbShape *)&rectP},
+  {"bitmapRArrow30", (const AbShape *)&rightArrow30},
+};
+
+/** Samples shape over its bounding box into bitmap.  shape is sampled
+ *  around screenCenter, since some getBounds clip to the screen.
+ */
+void
+bitmapFromShape(AbBitmap *bitmap, u_char bits[], u_char rowFirst[], u_char rowLast[],
+		const AbShape *shape)
+{
+  Region bounds;
+  int row, col, rowBytes;
+  abShapeGetBounds(shape, &screenCenter, &bounds);
+  vec2Sub(&bounds.topLeft, &bounds.topLeft, &screenCenter);
+  vec2Sub(&bounds.botRight, &bounds.botRight, &screenCenter);
+  bitmap->getBounds = abBitmapGetBounds;
+  bitmap->check = abBitmapCheck;
+  bitmap->width = bounds.botRight.axes[0] - bounds.topLeft.axes[0] + 1;
+  bitmap->height = bounds.botRight.axes[1] - bounds.topLeft.axes[1] + 1;
+  bitmap->centerCol = -bounds.topLeft.axes[0];
+  bitmap->centerRow = -bounds.topLeft.axes[1];
+  for (bitmap->rowShift = 0; (8 << bitmap->rowShift) < bitmap->width; bitmap->rowShift++)
+    ;
+  rowBytes = 1 << bitmap->rowShift;
+  assert(rowBytes * bitmap->height <= BITMAP_BYTES_MAX);
+  for (row = 0; row < bitmap->height; row++) {
+    rowFirst[row] = 0xff;
+    rowLast[row] = 0;
+    for (col = 0; col < rowBytes * 8; col++) {
+      Vec2 pixel = {screenCenter.axes[0] + col + bounds.topLeft.axes[0],
+		    screenCenter.axes[1] + row + bounds.topLeft.axes[1]};
+      u_char *byte = &bits[row * rowBytes + col / 8];
+      if (col % 8 == 0)
+	*byte = 0;
+      if (col < bitmap->width && abShapeCheck(shape, &screenCenter, &pixel)) {
+	*byte |= 0x80 >> (col % 8);
+	if (rowFirst[row] == 0xff)
+	  rowFirst[row] = col;
+	rowLast[row] = col;
+      }
+    }
+  }
+  bitmap->bits = bits;
+  bitmap->rowFirst = rowFirst;
+  bitmap->rowLast = rowLast;
+}
+
+/** Checks that bitmap answers exactly as shape does, both through
+ *  abShapeCheck() & abShapeRun(), at a few positions.
+ */
+void
+bitmapVerify(const AbBitmap *bitmap, const AbShape *shape)
+{
+  static const Vec2 centers[] = {{0,0}, {64,80}, {3,-7}, {-20,200}};
+  int i, row, col;
+  for (i = 0; i < sizeof(centers) / sizeof(centers[0]); i++) {
+    const Vec2 *center = &centers[i];
+    Region bounds;
+    abShapeGetBounds(shape, center, &bounds);
+    for (row = bounds.topLeft.axes[1] - 2; row <= bounds.botRight.axes[1] + 2; row++)
+      for (col = bounds.topLeft.axes[0] - 2; col <= bounds.botRight.axes[0] + 2; ) {
+	Vec2 pixel = {col, row};
+	int runEnd;
+	int covered = abShapeRun((const AbShape *)bitmap, center, &pixel, &runEnd);
+	assert(runEnd >= col);
+	if (runEnd > bounds.botRight.axes[0] + 2)
+	  runEnd = bounds.botRight.axes[0] + 2;
+	for (; col <= runEnd; col++) {
+	  Vec2 runPixel = {col, row};
+	  assert(abShapeCheck(shape, center, &runPixel) == covered);
+	  assert(abShapeCheck((const AbShape *)bitmap, center, &runPixel) == covered);
+	}
+      }
+  }
+}
+
+int main()
+{
+  static u_char bits[BITMAP_BYTES_MAX], rowFirst[256], rowLast[256];
+  FILE *srcFile = fopen("bitmaps.c", "w");
+  FILE *includeFile = fopen("bitmaps.h", "w");
+  int i, j;
+  assert(srcFile); assert(includeFile);
+
+  fprintf(srcFile, "// Automatically generated by makeBitmaps.\n");
+  fprintf(srcFile, "#include \"shape.h\"\n\n");
+  fprintf(includeFile, "// Automatically generated by makeBitmaps.\n");
+  fprintf(includeFile, "#ifndef bitmaps_included\n#define bitmaps_included\n\n");
+  fprintf(includeFile, "#include \"shape.h\"\n\n");
+
+  for (i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+    AbBitmap bitmap;
+    char *name = sources[i].name;
+    int nBytes;
+    bitmapFromShape(&bitmap, bits, rowFirst, rowLast, sources[i].shape);
+    bitmapVerify(&bitmap, sources[i].shape);
+    nBytes = bitmap.height << bitmap.rowShift;
+
+    fprintf(srcFile, "static const u_char %sBits[%d] = {", name, nBytes);
+    for (j = 0; j < nBytes; j++)
+      fprintf(srcFile, "%s0x%02x,", j % (1 << bitmap.rowShift) ? " " : "\n  ", bits[j]);
+    fprintf(srcFile, "\n};\n");
+    fprintf(srcFile, "static const u_char %sFirst[%d] = {", name, bitmap.height);
+    for (j = 0; j < bitmap.height; j++)
+      fprintf(srcFile, "%s%d,", j % 16 ? " " : "\n  ", rowFirst[j]);
+    fprintf(srcFile, "\n};\n");
+    fprintf(srcFile, "static const u_char %sLast[%d] = {", name, bitmap.height);
+    for (j = 0; j < bitmap.height; j++)
+      fprintf(srcFile, "%s%d,", j % 16 ? " " : "\n  ", rowLast[j]);
+    fprintf(srcFile, "\n};\n");
+    fprintf(srcFile, "const AbBitmap %s = {\n  abBitmapGetBounds, abBitmapCheck, %d, %d, %d, %d, %d,\n"
+	    "  %sBits, %sFirst, %sLast\n};\n\n",
+	    name, bitmap.width, bitmap.height, bitmap.centerCol, bitmap.centerRow,
+	    bitmap.rowShift, name, name, name);
+    fprintf(includeFile, "extern const AbBitmap %s;\n", name);
+  }
+
+  fprintf(includeFile, "\n#endif // included \n");
+  fclose(srcFile);
+  fclose(includeFile);
+  return 0;
+}
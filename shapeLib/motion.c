@@ -0,0 +1,29 @@
+#include "shape.h"
+
+u_char
+motionStep(Motion *motions, u_char n)
+{
+  u_char moved = 0;
+  for (; n; n--, motions++) {
+    Motion *m = motions;
+    Vec2 pos;
+    u_char axis;
+    char changed = 0;
+    layerGetPosNext(m->layer, &pos);
+    for (axis = 0; axis < 2; axis++) {
+      int sum;
+      m->velocity.axes[axis] += m->accel.axes[axis];
+      sum = m->frac[axis] + m->velocity.axes[axis];
+      if (sum >> FIX_SHIFT) {	/* whole pixels, rounded down */
+	pos.axes[axis] += sum >> FIX_SHIFT;
+	changed = 1;
+      }
+      m->frac[axis] = sum;	/* what is left below a pixel */
+    }
+    if (changed) {
+      layerSetPosNext(m->layer, &pos);
+      moved++;
+    }
+  }
+  return moved;
+}
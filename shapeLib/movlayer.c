@@ -0,0 +1,274 @@
+#include <libTimer.h>
+#include "lcdutils.h"
+#include "shape.h"
+
+RedrawStats redrawStats;
+
+/* Relative costs, roughly in CPU cycles on the G2553 */
+#define COST_BYTE  8		/* one byte over SPI */
+#define COST_SETUP 40		/* command/data switching around an address window */
+#define COST_CHECK 30		/* one abShapeCheck() */
+
+#define SETUP_BYTES 11		/* CASET + 4, PASET + 4, RAMWR */
+
+/** What a moving layer changed on screen this frame */
+typedef struct {
+  Region all;			/* union of old & new bounds */
+  Region kept;			/* overlap of old & new bounds */
+  char solid;			/* solid rect whose old & new bounds overlap */
+} MovDamage;
+
+/** True if l's last commit changed its position */
+static int
+movLayerMoved(const Layer *l)
+{
+  Vec2 pos, posLast;
+  layerGetPos(l, &pos);
+  layerGetPosLast(l, &posLast);
+  return pos.axes[0] != posLast.axes[0] || pos.axes[1] != posLast.axes[1];
+}
+
+static void
+movLayerDamage(const Layer *l, MovDamage *d)
+{
+  Region last, cur;
+  Vec2 pos, posLast;
+  layerGetPos(l, &pos);
+  layerGetPosLast(l, &posLast);
+  abShapeGetBounds(layerShape(l), &posLast, &last);
+  abShapeGetBounds(layerShape(l), &pos, &cur);
+  regionClipScreen(&last);
+  regionClipScreen(&cur);
+  regionUnion(&d->all, &last, &cur);
+  d->solid = ((void *)layerShape(l)->check == (void *)abRectCheck &&
+	      regionIntersect(&d->kept, &last, &cur));
+}
+
+/** Splits d->all minus d->kept into at most 4 strips.
+ *  Returns the number of (non-empty) strips.
+ */
+static int
+movDamageStrips(const MovDamage *d, Region strips[4])
+{
+  int n = 0;
+  Region strip;
+
+  strip = d->all;		/* rows above kept */
+  strip.botRight.axes[1] = d->kept.topLeft.axes[1] - 1;
+  if (strip.topLeft.axes[1] <= strip.botRight.axes[1])
+    strips[n++] = strip;
+
+  strip = d->all;		/* rows below kept */
+  strip.topLeft.axes[1] = d->kept.botRight.axes[1] + 1;
+  if (strip.topLeft.axes[1] <= strip.botRight.axes[1])
+    strips[n++] = strip;
+
+  strip.topLeft.axes[1] = d->kept.topLeft.axes[1]; /* columns left of kept */
+  strip.botRight.axes[1] = d->kept.botRight.axes[1];
+  strip.topLeft.axes[0] = d->all.topLeft.axes[0];
+  strip.botRight.axes[0] = d->kept.topLeft.axes[0] - 1;
+  if (strip.topLeft.axes[0] <= strip.botRight.axes[0])
+    strips[n++] = strip;
+
+  strip.topLeft.axes[0] = d->kept.botRight.axes[0] + 1; /* columns right of kept */
+  strip.botRight.axes[0] = d->all.botRight.axes[0];
+  if (strip.topLeft.axes[0] <= strip.botRight.axes[0])
+    strips[n++] = strip;
+
+  return n;
+}
+
+static long
+regionArea(const Region *r)
+{
+  return (long)(r->botRight.axes[0] - r->topLeft.axes[0] + 1) *
+    (r->botRight.axes[1] - r->topLeft.axes[1] + 1);
+}
+
+/** Adds the cost of compositing region r over nLayers layers */
+static void
+costRegion(long *cost, const Region *r, int nLayers)
+{
+  long area = regionArea(r);
+  *cost += COST_SETUP + SETUP_BYTES * COST_BYTE
+    + area * (2 * COST_BYTE + nLayers * COST_CHECK);
+}
+
+/** Returns true if a layer above l (earlier in the list) covers any pixel of r */
+static int
+regionOccluded(Layer *layers, const Layer *l, const Region *r)
+{
+  int row, col;
+  Layer *probeLayer;
+  for (probeLayer = layers; probeLayer != l; probeLayer = layerNext(probeLayer)) {
+    Region probeBounds, overlap;
+    Vec2 pos;
+    layerGetPos(probeLayer, &pos);
+    abShapeGetBounds(layerShape(probeLayer), &pos, &probeBounds);
+    if (!regionIntersect(&overlap, &probeBounds, r))
+      continue;			/* cheap reject on bounding boxes */
+    for (row = overlap.topLeft.axes[1]; row <= overlap.botRight.axes[1]; row++)
+      for (col = overlap.topLeft.axes[0]; col <= overlap.botRight.axes[0]; col++) {
+	Vec2 pixelPos = {col, row};
+	if (layerCheck(probeLayer, &pixelPos))
+	  return 1;
+      }
+  }
+  return 0;
+}
+
+/** Estimates the pixels regionOccluded() might probe */
+static long
+occlusionArea(Layer *layers, const Layer *l, const Region *r)
+{
+  long area = 0;
+  Layer *probeLayer;
+  for (probeLayer = layers; probeLayer != l; probeLayer = layerNext(probeLayer)) {
+    Region probeBounds, overlap;
+    Vec2 pos;
+    layerGetPos(probeLayer, &pos);
+    abShapeGetBounds(layerShape(probeLayer), &pos, &probeBounds);
+    if (regionIntersect(&overlap, &probeBounds, r))
+      area += regionArea(&overlap);
+  }
+  return area;
+}
+
+static int
+layerCount(const Layer *l)
+{
+  int n = 0;
+  for (; l; l = layerNext(l))
+    n++;
+  return n;
+}
+
+/** Costs of redrawing one moving layer's damage as the union of its old
+ *  & new bounds, or as strips around the part that kept its color.
+ *  deltaCost is only computed for solid damage.
+ */
+static void
+movDamageCosts(Layer *layers, const Layer *l, const MovDamage *d, int nLayers,
+	       long *unionCost, long *deltaCost)
+{
+  *unionCost = 0;
+  costRegion(unionCost, &d->all, nLayers);
+  if (d->solid) {
+    Region strips[4];
+    int i, n = movDamageStrips(d, strips);
+    *deltaCost = occlusionArea(layers, l, &d->kept) * COST_CHECK;
+    for (i = 0; i < n; i++)
+      costRegion(deltaCost, &strips[i], nLayers);
+  }
+}
+
+/** Estimates the cost of each plan for the current frame */
+static void
+movLayerPlanCosts(MovLayer *movLayers, Layer *layers, long cost[REDRAW_PLANS])
+{
+  int nLayers = layerCount(layers);
+  Region merged;
+  MovLayer *movLayer;
+  char any = 0;
+
+  cost[REDRAW_UNION] = cost[REDRAW_DELTA] = cost[REDRAW_MERGED] = 0;
+  for (movLayer = movLayers; movLayer; movLayer = movLayerNext(movLayer)) {
+    MovDamage d;
+    long unionCost, deltaCost;
+    if (!movLayerMoved(movLayerLayer(movLayer)))
+      continue;
+    movLayerDamage(movLayerLayer(movLayer), &d);
+    movDamageCosts(layers, movLayerLayer(movLayer), &d, nLayers, &unionCost, &deltaCost);
+    cost[REDRAW_UNION] += unionCost;
+    cost[REDRAW_DELTA] += (d.solid && deltaCost < unionCost) ? deltaCost : unionCost;
+    if (!any)
+      merged = d.all;
+    else
+      regionUnion(&merged, &merged, &d.all);
+    any = 1;
+  }
+  if (any)
+    costRegion(&cost[REDRAW_MERGED], &merged, nLayers);
+}
+
+/** Counts SPI bytes written for region r */
+static void
+movLayerDrawRegion(Layer *layers, const Region *r)
+{
+  redrawStats.bytes += SETUP_BYTES + 2 * regionArea(r);
+  layerDrawRegion(layers, r);
+}
+
+/** Redraws each moving layer's damage separately, as strips when 
+ *  useStrips is set and that is cheaper.
+ */
+static void
+movLayerDrawEach(MovLayer *movLayer, Layer *layers, char useStrips)
+{
+  int nLayers = layerCount(layers);
+  for (; movLayer; movLayer = movLayerNext(movLayer)) {
+    Layer *l = movLayerLayer(movLayer);
+    MovDamage d;
+    long unionCost, deltaCost;
+    if (!movLayerMoved(l))
+      continue;			/* nothing changed on screen */
+    movLayerDamage(l, &d);
+    if (useStrips && d.solid)
+      movDamageCosts(layers, l, &d, nLayers, &unionCost, &deltaCost);
+    /* a solid rectangle that moved less than its own size and is not
+       covered by a higher layer only needs its leading & trailing strips */
+    if (useStrips && d.solid && deltaCost < unionCost &&
+	!regionOccluded(layers, l, &d.kept)) {
+      Region strips[4];
+      int i, n = movDamageStrips(&d, strips);
+      for (i = 0; i < n; i++)
+	movLayerDrawRegion(layers, &strips[i]);
+    } else
+      movLayerDrawRegion(layers, &d.all);
+  } // for moving layer being updated
+}
+
+void
+movLayerDraw(MovLayer *movLayers, Layer *layers)
+{
+  long *cost = redrawStats.cost;
+  u_char plan, p;
+  MovLayer *movLayer;
+
+  and_sr(~8);			/**< disable interrupts (GIE off) */
+  for (movLayer = movLayers; movLayer; movLayer = movLayerNext(movLayer)) { /* for each moving layer */
+    layerCommitPos(movLayerLayer(movLayer));
+  }
+  or_sr(8);			/**< disable interrupts (GIE on) */
+
+  layerBakeRefresh(layers);
+  movLayerPlanCosts(movLayers, layers, cost);
+  for (plan = p = 0; p < REDRAW_PLANS; p++) /* cheapest plan wins */
+    if (cost[p] < cost[plan])
+      plan = p;
+  redrawStats.plan = plan;
+  redrawStats.frames[plan]++;
+
+  switch (plan) {
+  case REDRAW_MERGED: {
+    Region merged;
+    MovDamage d;
+    char any = 0;
+    for (movLayer = movLayers; movLayer; movLayer = movLayerNext(movLayer)) {
+      if (!movLayerMoved(movLayerLayer(movLayer)))
+	continue;
+      movLayerDamage(movLayerLayer(movLayer), &d);
+      if (!any)
+	merged = d.all;
+      else
+	regionUnion(&merged, &merged, &d.all);
+      any = 1;
+    }
+    if (any)
+      movLayerDrawRegion(layers, &merged);
+    break;
+  }
+  default:			/* REDRAW_UNION or REDRAW_DELTA */
+    movLayerDrawEach(movLayers, layers, plan == REDRAW_DELTA);
+  }
+}
@@ -0,0 +1,132 @@
+#include "shape.h"
+#include "shapekernels.h"
+
+/* one of the layers being compared, with its shape's kind looked up */
+typedef struct {
+  Layer *layer;
+  const AbShape *abShape;
+  Vec2 pos;
+  u_char kind;			/* SHAPE_USER: use layerRun() */
+} OverlapProbe;
+
+static void
+overlapProbeInit(OverlapProbe *p, Layer *l)
+{
+  LayerBake *bake = layerBakeOf(l);
+  p->layer = l;
+  p->abShape = layerShape(l);
+  layerGetPos(l, &p->pos);
+  if ((bake && bake->valid) || (shapeCache && shapeCacheHas(shapeCache, p->abShape)))
+    p->kind = SHAPE_USER;
+  else
+    p->kind = abShapeKind(p->abShape);
+}
+
+static inline int
+overlapProbeRun(OverlapProbe *p, const Vec2 *pixel, int *runEnd)
+{
+  switch (p->kind) {
+#define SHAPE_KIND_CASE(kind, type, check, kernel)			\
+  case kind: return kernel((const type *)p->abShape, &p->pos, pixel, runEnd);
+  SHAPE_KINDS(SHAPE_KIND_CASE)
+#undef SHAPE_KIND_CASE
+  }
+  return layerRun(p->layer, pixel, runEnd); /* baked, cached or user shape */
+}
+
+/* first column from col to right of row covered by both a and b, or
+   right + 1; *end is the last column of that common run.  a is probed
+   first and b only where a covers, each only when its run ends. */
+static int
+overlapRow(OverlapProbe *a, OverlapProbe *b, int row, int col, int right, int *end)
+{
+  Vec2 pixel;
+  int aEnd = col - 1, bEnd = col - 1, aIn = 0, bIn = 0, next;
+  pixel.axes[1] = row;
+  for (pixel.axes[0] = col; ; pixel.axes[0] = next + 1) {
+    if (aEnd < pixel.axes[0])
+      aIn = overlapProbeRun(a, &pixel, &aEnd);
+    if (!aIn)
+      next = aEnd;
+    else {
+      if (bEnd < pixel.axes[0])
+	bIn = overlapProbeRun(b, &pixel, &bEnd);
+      if (bIn) {
+	next = aEnd < bEnd ? aEnd : bEnd;
+	*end = next < right ? next : right;
+	return pixel.axes[0];
+      }
+      next = bEnd;
+    }
+    if (next >= right)
+      return right + 1;
+  }
+}
+
+/* sets up the probes, the one with longer runs first; false if the
+   bounds do not even overlap */
+static int
+overlapPrepare(Layer *a, Layer *b, OverlapProbe *p, Region *overlap)
+{
+  Region aBounds, bBounds;
+  if (layerShape(a)->check != layerShape(b)->check &&
+      abShapeKind(layerShape(a)) == SHAPE_USER) {
+    Layer *t = a;		/* a user shape answers one pixel at a time */
+    a = b;
+    b = t;
+  }
+  overlapProbeInit(&p[0], a);
+  overlapProbeInit(&p[1], b);
+  abShapeGetBounds(p[0].abShape, &p[0].pos, &aBounds);
+  abShapeGetBounds(p[1].abShape, &p[1].pos, &bBounds);
+  return regionIntersect(overlap, &aBounds, &bBounds);
+}
+
+int
+shapesOverlap(Layer *a, Layer *b, Vec2 *contact)
+{
+  OverlapProbe p[2];
+  Region r;
+  int row, col, end;
+  if (!overlapPrepare(a, b, p, &r))
+    return 0;
+  for (row = r.topLeft.axes[1]; row <= r.botRight.axes[1]; row++) {
+    col = overlapRow(&p[0], &p[1], row, r.topLeft.axes[0], r.botRight.axes[0], &end);
+    if (col <= r.botRight.axes[0]) {
+      if (contact) {
+	contact->axes[0] = col;
+	contact->axes[1] = row;
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+shapesContact(Layer *a, Layer *b, Region *contact)
+{
+  OverlapProbe p[2];
+  Region r;
+  int row, col, end, count = 0;
+  if (!overlapPrepare(a, b, p, &r))
+    return 0;
+  for (row = r.topLeft.axes[1]; row <= r.botRight.axes[1]; row++) {
+    for (col = r.topLeft.axes[0]; col <= r.botRight.axes[0]; col = end + 1) {
+      col = overlapRow(&p[0], &p[1], row, col, r.botRight.axes[0], &end);
+      if (col > r.botRight.axes[0])
+	break;
+      if (!count) {
+	contact->topLeft.axes[0] = contact->botRight.axes[0] = col;
+	contact->topLeft.axes[1] = row;
+      }
+      if (col < contact->topLeft.axes[0])
+	contact->topLeft.axes[0] = col;
+      if (end > contact->botRight.axes[0])
+	contact->botRight.axes[0] = end;
+      contact->botRight.axes[1] = row;
+      count += end - col + 1;
+    }
+  }
+  return count;
+}
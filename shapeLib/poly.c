@@ -0,0 +1,179 @@
+#include "shape.h"
+#include "shapekernels.h"
+
+/* sets bounds & orientation of poly, once */
+static void
+polyPrepare(const AbConvexPoly *poly)
+{
+  PolyState *state = poly->state;
+  const PolyVertex *v = poly->vertices;
+  int area = 0;			/* twice the signed area */
+  u_char i;
+  if (state->ready)
+    return;
+  state->bounds.topLeft.axes[0] = state->bounds.botRight.axes[0] = v[0].col;
+  state->bounds.topLeft.axes[1] = state->bounds.botRight.axes[1] = v[0].row;
+  for (i = 0; i < poly->n; i++) {
+    const PolyVertex *next = &v[i + 1 < poly->n ? i + 1 : 0];
+    Vec2 vertex = {v[i].col, v[i].row};
+    vec2Min(&state->bounds.topLeft, &state->bounds.topLeft, &vertex);
+    vec2Max(&state->bounds.botRight, &state->bounds.botRight, &vertex);
+    area += v[i].col * next->row - next->col * v[i].row;
+  }
+  state->reversed = area > 0;	/* clockwise on screen (rows grow down) */
+  state->rowValid = 0;
+  state->ready = 1;
+}
+
+/* edge i, oriented so that its function is positive inside */
+static void
+polyEdge(const AbConvexPoly *poly, u_char i, const PolyVertex **from, const PolyVertex **to)
+{
+  const PolyVertex *a = &poly->vertices[i];
+  const PolyVertex *b = &poly->vertices[i + 1 < poly->n ? i + 1 : 0];
+  if (poly->state->reversed) {
+    *from = b; *to = a;
+  } else {
+    *from = a; *to = b;
+  }
+}
+
+void
+abConvexPolyGetBounds(const AbConvexPoly *poly, const Vec2 *centerPos, Region *bounds)
+{
+  polyPrepare(poly);
+  vec2Add(&bounds->topLeft, centerPos, &poly->state->bounds.topLeft);
+  vec2Add(&bounds->botRight, centerPos, &poly->state->bounds.botRight);
+}
+
+int
+abConvexPolyCheck(const AbConvexPoly *poly, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  const Region *bounds;
+  int col = pixel->axes[0] - centerPos->axes[0];
+  int row = pixel->axes[1] - centerPos->axes[1];
+  u_char i;
+  polyPrepare(poly);
+  bounds = &poly->state->bounds;
+  if (col < bounds->topLeft.axes[0] || col > bounds->botRight.axes[0] ||
+      row < bounds->topLeft.axes[1] || row > bounds->botRight.axes[1])
+    return 0;
+  for (i = 0; i < poly->n; i++) {
+    const PolyVertex *from, *to;
+    polyEdge(poly, i, &from, &to);
+    if ((col - from->col) * (to->row - from->row) <
+	(row - from->row) * (to->col - from->col))
+      return 0;			/* outside this edge */
+  }
+  return 1;
+}
+
+/* moves edge's column to where it crosses the row its function is at:
+   the first column inside (dRow > 0) or the last (dRow < 0), kept
+   within one column of left..right */
+static void
+polyEdgeFix(PolyEdge *edge, int dRow, int left, int right)
+{
+  if (dRow > 0) {
+    while (edge->col <= right && edge->e < 0) {
+      edge->col++;
+      edge->e += dRow;
+    }
+    while (edge->col > left && edge->e - dRow >= 0) {
+      edge->col--;
+      edge->e -= dRow;
+    }
+  } else if (dRow < 0) {
+    while (edge->col >= left && edge->e < 0) {
+      edge->col--;
+      edge->e -= dRow;
+    }
+    while (edge->col < right && edge->e + dRow >= 0) {
+      edge->col++;
+      edge->e += dRow;
+    }
+  }
+}
+
+/* steps every edge to the next row (dir 1) or the previous (dir -1) */
+static void
+polyStep(const AbConvexPoly *poly, int dir)
+{
+  PolyState *state = poly->state;
+  u_char i;
+  for (i = 0; i < poly->n; i++) {
+    PolyEdge *edge = &state->edges[i];
+    const PolyVertex *from, *to;
+    int dCol;
+    polyEdge(poly, i, &from, &to);
+    dCol = to->col - from->col;
+    edge->e += dir > 0 ? -dCol : dCol;
+    polyEdgeFix(edge, to->row - from->row,
+		state->bounds.topLeft.axes[0], state->bounds.botRight.axes[0]);
+  }
+  state->row += dir;
+}
+
+/* steps the edges to row, starting from the top row if they are not
+   stepped to any row yet */
+static void
+polyRow(const AbConvexPoly *poly, int row)
+{
+  PolyState *state = poly->state;
+  u_char i;
+  if (!state->rowValid) {
+    int top = state->bounds.topLeft.axes[1];
+    for (i = 0; i < poly->n; i++) {
+      PolyEdge *edge = &state->edges[i];
+      const PolyVertex *from, *to;
+      int r;
+      polyEdge(poly, i, &from, &to);
+      edge->col = from->col;
+      edge->e = 0;		/* at the edge's first vertex */
+      for (r = from->row; r > top; r--)
+	edge->e += to->col - from->col;
+      polyEdgeFix(edge, to->row - from->row,
+		  state->bounds.topLeft.axes[0], state->bounds.botRight.axes[0]);
+    }
+    state->row = top;
+    state->rowValid = 1;
+  }
+  while (state->row < row)
+    polyStep(poly, 1);
+  while (state->row > row)
+    polyStep(poly, -1);
+}
+
+int
+abConvexPolyRun(const AbConvexPoly *poly, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  PolyState *state;
+  int row = pixel->axes[1] - centerPos->axes[1];
+  int left, right;
+  u_char i;
+  polyPrepare(poly);
+  state = poly->state;
+  left = state->bounds.topLeft.axes[0];
+  right = state->bounds.botRight.axes[0];
+  if (row < state->bounds.topLeft.axes[1] || row > state->bounds.botRight.axes[1])
+    left = right + 1;		/* no span */
+  else {
+    polyRow(poly, row);
+    for (i = 0; i < poly->n; i++) {
+      const PolyEdge *edge = &state->edges[i];
+      const PolyVertex *from, *to;
+      int dRow;
+      polyEdge(poly, i, &from, &to);
+      dRow = to->row - from->row;
+      if (dRow > 0 && edge->col > left)
+	left = edge->col;
+      else if (dRow < 0 && edge->col < right)
+	right = edge->col;
+      else if (!dRow && ((to->col > from->col && row > from->row) ||
+			 (to->col < from->col && row < from->row)))
+	left = right + 1;	/* beyond a horizontal edge */
+    }
+  }
+  return spanRun(centerPos->axes[0] + left, centerPos->axes[0] + right,
+		 pixel->axes[0], runEnd);
+}
@@ -0,0 +1,175 @@
+#include "shape.h"
+
+/* slot of l if it is one of pool's layers, else LAYER_NONE */
+static u_char
+poolSlot(const LayerPool *pool, const Layer *l)
+{
+  if (l < pool->layers || l >= pool->layers + pool->capacity)
+    return LAYER_NONE;
+  return l - pool->layers;
+}
+
+/* links slot's layer (and moving layer) to slot next, or to below */
+static void
+poolLink(LayerPool *pool, u_char slot, u_char next)
+{
+  Layer *nextLayer = (next == LAYER_NONE) ? pool->below : &pool->layers[next];
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+  pool->layerDescs[slot].next = nextLayer;
+#elif LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+  pool->layers[slot].next = nextLayer ? nextLayer - layerArena : LAYER_NONE;
+#else
+  pool->layers[slot].next = nextLayer;
+#endif
+  if (pool->movLayers) {
+    MovLayer *nextMov = (next == LAYER_NONE) ? pool->movBelow : &pool->movLayers[next];
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+    pool->movLayerDescs[slot].next = nextMov;
+#else
+    pool->movLayers[slot].next = nextMov;
+#endif
+  }
+}
+
+/* adds l's bounds to the region to redraw */
+static void
+poolDirty(LayerPool *pool, const Layer *l)
+{
+  Region bounds;
+  Vec2 pos;
+  layerGetPos(l, &pos);
+  abShapeGetBounds(layerShape(l), &pos, &bounds);
+  regionClipScreen(&bounds);
+  if (pool->dirtyValid)
+    regionUnion(&pool->dirty, &pool->dirty, &bounds);
+  else
+    pool->dirty = bounds;
+  pool->dirtyValid = 1;
+}
+
+void
+layerPoolInit(LayerPool *pool, Layer *below, MovLayer *movBelow)
+{
+  u_char i;
+  pool->below = below;
+  pool->movBelow = movBelow;
+  pool->top = LAYER_NONE;
+  pool->free = 0;
+  pool->count = 0;
+  pool->dirtyValid = 0;
+  for (i = 0; i < pool->capacity; i++) {
+    pool->gens[i] = 0;
+    pool->links[i] = (i + 1 < pool->capacity) ? i + 1 : LAYER_NONE;
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+    pool->layers[i].desc = &pool->layerDescs[i];
+    pool->layers[i].bake = 0;
+    if (pool->movLayers) {
+      pool->movLayerDescs[i].layer = &pool->layers[i];
+      pool->movLayers[i].desc = &pool->movLayerDescs[i];
+    }
+#elif LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+    if (pool->movLayers)
+      pool->movLayers[i].layer = &pool->layers[i];
+#else
+    pool->layers[i].bake = 0;
+    if (pool->movLayers)
+      pool->movLayers[i].layer = &pool->layers[i];
+#endif
+  }
+  if (!pool->capacity)
+    pool->free = LAYER_NONE;
+}
+
+LayerHandle
+layerPoolSpawn(LayerPool *pool, const AbShape *shape, LayerColor color,
+	       const Vec2 *pos, const Vec2 *velocity)
+{
+  u_char slot = pool->free;
+  Layer *l;
+  if (slot == LAYER_NONE)
+    return LAYER_HANDLE_NONE;
+  pool->free = pool->links[slot];
+  l = &pool->layers[slot];
+
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+  pool->layerDescs[slot].abShape = shape;
+  pool->layerDescs[slot].color = color;
+  pool->layerDescs[slot].posInit = *pos;
+  l->pos = l->posLast = l->posNext = *pos;
+#elif LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+  l->abShape = shape;
+  l->col = pos->axes[0];
+  l->row = pos->axes[1];
+  l->lastCol = l->lastRow = l->nextCol = l->nextRow = 0;
+  l->color = color;
+  l->flags = 0;
+#else
+  l->abShape = (AbShape *)shape;
+  l->pos = l->posLast = l->posNext = *pos;
+  l->color = color;
+#endif
+  if (pool->movLayers)
+    pool->movLayers[slot].velocity = *velocity;
+  poolDirty(pool, l);		/* movLayerDraw() assumes it is on screen */
+
+  poolLink(pool, slot, pool->top); /* on top of the band */
+  pool->links[slot] = LAYER_NONE;
+  if (pool->top != LAYER_NONE)
+    pool->links[pool->top] = slot;
+  pool->top = slot;
+  pool->count++;
+  pool->gens[slot]++;		/* odd: in use */
+  return (pool->gens[slot] << 8) | slot;
+}
+
+Layer *
+layerPoolLayer(const LayerPool *pool, LayerHandle h)
+{
+  u_char slot = h & 0xff, gen = h >> 8;
+  if (slot >= pool->capacity || !(gen & 1) || pool->gens[slot] != gen)
+    return 0;
+  return &pool->layers[slot];
+}
+
+MovLayer *
+layerPoolMovLayer(const LayerPool *pool, LayerHandle h)
+{
+  if (!pool->movLayers || !layerPoolLayer(pool, h))
+    return 0;
+  return &pool->movLayers[h & 0xff];
+}
+
+int
+layerPoolDespawn(LayerPool *pool, LayerHandle h)
+{
+  Layer *l = layerPoolLayer(pool, h);
+  u_char slot, above, next;
+  if (!l)
+    return 0;
+  slot = h & 0xff;
+  poolDirty(pool, l);		/* where it was last drawn */
+
+  above = pool->links[slot];	/* unlink */
+  next = poolSlot(pool, layerNext(l));
+  if (above == LAYER_NONE)
+    pool->top = next;
+  else
+    poolLink(pool, above, next);
+  if (next != LAYER_NONE)
+    pool->links[next] = above;
+
+  pool->links[slot] = pool->free;
+  pool->free = slot;
+  pool->count--;
+  pool->gens[slot]++;		/* even: free, and h is stale */
+  return 1;
+}
+
+void
+layerPoolRedraw(LayerPool *pool, Layer *layers)
+{
+  if (!pool->dirtyValid)
+    return;
+  pool->dirtyValid = 0;
+  layerDrawRegion(layers, &pool->dirty);
+}
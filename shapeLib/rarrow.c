@@ -1,4 +1,5 @@
 #include "shape.h"
+#include "shapekernels.h"
 
 
 /** Check function required by AbShape
@@ -24,6 +25,14 @@ abRArrowCheck(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel)
   return within;
 }
   
+/** Row-span fast path, see abShapeRun()
+ */
+int
+abRArrowRun(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return rarrowKernel(arrow, centerPos, pixel, runEnd);
+}
+
 /** Check function required by AbShape
  *  abRArrowGetBounds computes a right arrow's bounding box
  */
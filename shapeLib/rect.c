@@ -1,4 +1,5 @@
 #include "shape.h"
+#include "shapekernels.h"
 
 // true if pixel is in rect centerPosed at rectPos
 int 
@@ -15,6 +16,13 @@ abRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel)
   return within;
 }
 
+// like abRectCheck, also returns the last column with the same answer
+int
+abRectRun(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return rectKernel(rect, centerPos, pixel, runEnd);
+}
+
 // compute bounding box in screen coordinates for rect at centerPos
 void abRectGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *bounds)
 {
@@ -42,6 +50,13 @@ abRectOutlineCheck(const AbRectOutline *rect, const Vec2 *centerPos, const Vec2
 	  );
 }
  
+// like abRectOutlineCheck, also returns the last column with the same answer
+int
+abRectOutlineRun(const AbRectOutline *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  return rectOutlineKernel(rect, centerPos, pixel, runEnd);
+}
+ 
 // compute bounding box in screen coordinates for rect at centerPos
 void abRectOutlineGetBounds(const AbRectOutline *rect, const Vec2 *centerPos, Region *bounds)
 {
@@ -8,6 +8,16 @@ regionUnion(Region *rUnion, const Region *r1, const Region *r2)
   vec2Max(&rUnion->botRight, &r1->botRight, &r2->botRight);
 }
 
+// compute overlap of two regions, false if they are disjoint
+int
+regionIntersect(Region *rInter, const Region *r1, const Region *r2)
+{
+  vec2Max(&rInter->topLeft, &r1->topLeft, &r2->topLeft);
+  vec2Min(&rInter->botRight, &r1->botRight, &r2->botRight);
+  return (rInter->topLeft.axes[0] <= rInter->botRight.axes[0] &&
+	  rInter->topLeft.axes[1] <= rInter->botRight.axes[1]);
+}
+
 // Trims extent of region to screen bounds
 void regionClipScreen(Region *r)
 {
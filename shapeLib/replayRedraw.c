@@ -0,0 +1,243 @@
+// Replays a recorded game session through movLayerDraw() and through the
+// redraw it replaced (strips for solid rects, else old & new bounds),
+// checking every frame against a full redraw and comparing SPI bytes.
+// Runs on the host, built by the Makefile.
+
+#include <stdio.h>
+#include <string.h>
+#include "shape.h"
+#include "hostLcd.h"
+
+const AbRect bar = {abRectGetBounds, abRectCheck, {20,2}};
+const AbRect square = {abRectGetBounds, abRectCheck, {6,6}};
+const AbRect cabin = {abRectGetBounds, abRectCheck, {8,3}};
+const AbRArrow nose = {abRArrowGetBounds, abRArrowCheck, 10};
+u_char chords10[11];
+const AbCircle body = {abCircleGetBounds, abCircleCheck, chords10, 10};
+const AbRectOutline fieldOutline = {
+  abRectOutlineGetBounds, abRectOutlineCheck,
+  {screenWidth/2-10, screenHeight/2-10}
+};
+
+/* the game: its field, bars and square */
+LAYER(layer10, &bar, COLOR_RED, screenWidth/2, 30, 0);
+LAYER(layer11, &bar, COLOR_GREEN, screenWidth/2, 80, &layer10);
+LAYER(layer12, &bar, COLOR_YELLOW, screenWidth/2, 120, &layer11);
+LAYER(layer13, &square, COLOR_BLUE, screenWidth/2, 140, &layer12);
+LAYER(fieldLayer, &fieldOutline, COLOR_BLACK, screenWidth/2, screenHeight/2, &layer13);
+
+MOVLAYER(ml10, &layer10, 2, 0, 0);
+MOVLAYER(ml11, &layer11, 3, 0, &ml10);
+MOVLAYER(ml12, &layer12, 2, 0, &ml11);
+MOVLAYER(ml13, &layer13, 0, 0, &ml12);
+
+/* a ship of three overlapping layers that move together */
+LAYER(bodyLayer, &body, COLOR_GRAY, 50, 70, 0);
+LAYER(cabinLayer, &cabin, COLOR_SKY_BLUE, 50, 66, &bodyLayer);
+LAYER(noseLayer, &nose, COLOR_RED, 68, 70, &cabinLayer);
+LAYER(spaceLayer, &fieldOutline, COLOR_BLACK, screenWidth/2, screenHeight/2, &noseLayer);
+
+MOVLAYER(mlBody, &bodyLayer, 0, 0, 0);
+MOVLAYER(mlCabin, &cabinLayer, 0, 0, &mlBody);
+MOVLAYER(mlNose, &noseLayer, 0, 0, &mlCabin);
+
+/* a recorded session: the velocity of the steered layers from a frame on */
+typedef struct {
+  int frame;
+  signed char col, row;
+} SessionEvent;
+
+const SessionEvent gameSession[] = {
+  {0, 0, 0}, {20, 0, -1}, {45, 3, 0}, {52, 0, -1}, {80, -3, 0},
+  {95, 0, 0}, {120, 0, 1}, {130, -3, 0}, {150, 0, -1}, {190, 3, 0},
+  {205, 0, -1}, {240, 0, 0}, {260, -3, 0}, {280, 0, 1}, {300, 0, 0},
+  {-1},
+};
+const SessionEvent shipSession[] = {
+  {0, 2, 0}, {15, 1, 1}, {40, 0, 2}, {60, -1, 1}, {80, -2, 0},
+  {110, 0, 0}, {130, 0, -2}, {160, 3, 0}, {180, 1, -1}, {220, -3, 1},
+  {250, 0, 0}, {270, 2, 2}, {290, -1, -2},
+  {-1},
+};
+
+typedef struct {
+  char *name;
+  Layer *layers;
+  MovLayer *movLayers;
+  MovLayer *steered[4];		/* 0-terminated */
+  const SessionEvent *session;
+} Scene;
+
+const Scene scenes[] = {
+  {"game", &fieldLayer, &ml13, {&ml13}, gameSession},
+  {"ship", &spaceLayer, &mlNose, {&mlNose, &mlCabin, &mlBody}, shipSession},
+};
+#define N_SCENES (sizeof scenes / sizeof scenes[0])
+#define N_FRAMES 320
+#define N_MOVLAYERS_MAX 4
+
+Region fence;
+
+/** Moves every layer by its velocity, bouncing off the fence (mlAdvance).
+ *  Bounds are measured at screenCenter, as circles clip theirs to the screen.
+ */
+void
+advance(MovLayer *ml)
+{
+  Vec2 newPos, posNext;
+  Region bounds;
+  u_char axis;
+  for (; ml; ml = movLayerNext(ml)) {
+    layerGetPosNext(movLayerLayer(ml), &posNext);
+    vec2Add(&newPos, &posNext, &ml->velocity);
+    abShapeGetBounds(layerShape(movLayerLayer(ml)), &screenCenter, &bounds);
+    for (axis = 0; axis < 2; axis++)
+      if (bounds.topLeft.axes[axis] - screenCenter.axes[axis] + newPos.axes[axis] <
+	  fence.topLeft.axes[axis] ||
+	  bounds.botRight.axes[axis] - screenCenter.axes[axis] + newPos.axes[axis] >
+	  fence.botRight.axes[axis]) {
+	int velocity = ml->velocity.axes[axis] = -ml->velocity.axes[axis];
+	newPos.axes[axis] += 2 * velocity;
+      }
+    layerSetPosNext(movLayerLayer(ml), &newPos);
+  }
+}
+
+/* true if a layer above l covers a pixel of r */
+int
+occluded(Layer *layers, Layer *l, const Region *r)
+{
+  Vec2 pixel;
+  for (; layers != l; layers = layerNext(layers))
+    for (pixel.axes[1] = r->topLeft.axes[1]; pixel.axes[1] <= r->botRight.axes[1]; pixel.axes[1]++)
+      for (pixel.axes[0] = r->topLeft.axes[0]; pixel.axes[0] <= r->botRight.axes[0]; pixel.axes[0]++)
+	if (layerCheck(layers, &pixel))
+	  return 1;
+  return 0;
+}
+
+/* draws the parts of all - kept, as the strips drawDelta() used to */
+void
+drawStrips(Layer *layers, const Region *all, const Region *kept)
+{
+  Region strip = *all;
+  strip.botRight.axes[1] = kept->topLeft.axes[1] - 1;
+  if (strip.topLeft.axes[1] <= strip.botRight.axes[1])
+    layerDrawRegion(layers, &strip);
+  strip = *all;
+  strip.topLeft.axes[1] = kept->botRight.axes[1] + 1;
+  if (strip.topLeft.axes[1] <= strip.botRight.axes[1])
+    layerDrawRegion(layers, &strip);
+  strip.topLeft.axes[1] = kept->topLeft.axes[1];
+  strip.botRight.axes[1] = kept->botRight.axes[1];
+  strip.topLeft.axes[0] = all->topLeft.axes[0];
+  strip.botRight.axes[0] = kept->topLeft.axes[0] - 1;
+  if (strip.topLeft.axes[0] <= strip.botRight.axes[0])
+    layerDrawRegion(layers, &strip);
+  strip.topLeft.axes[0] = kept->botRight.axes[0] + 1;
+  strip.botRight.axes[0] = all->botRight.axes[0];
+  if (strip.topLeft.axes[0] <= strip.botRight.axes[0])
+    layerDrawRegion(layers, &strip);
+}
+
+/** The redraw movLayerDraw() did before it chose between plans */
+void
+previousDraw(MovLayer *movLayers, Layer *layers)
+{
+  MovLayer *ml;
+  for (ml = movLayers; ml; ml = movLayerNext(ml))
+    layerCommitPos(movLayerLayer(ml));
+  for (ml = movLayers; ml; ml = movLayerNext(ml)) {
+    Layer *l = movLayerLayer(ml);
+    Region last, cur, all, kept;
+    Vec2 pos, posLast;
+    layerGetPos(l, &pos);
+    layerGetPosLast(l, &posLast);
+    abShapeGetBounds(layerShape(l), &posLast, &last);
+    abShapeGetBounds(layerShape(l), &pos, &cur);
+    regionClipScreen(&last);
+    regionClipScreen(&cur);
+    regionUnion(&all, &last, &cur);
+    if ((void *)layerShape(l)->check == (void *)abRectCheck &&
+	regionIntersect(&kept, &last, &cur) && !occluded(layers, l, &kept))
+      drawStrips(layers, &all, &kept);
+    else
+      layerDrawRegion(layers, &all);
+  }
+}
+
+u_int drawn[screenHeight][screenWidth];
+
+/** Plays scene's session, redrawing with draw; returns the SPI bytes sent */
+long
+replay(const Scene *scene, void (*draw)(MovLayer *, Layer *), u_int *badFrames)
+{
+  Vec2 start[N_MOVLAYERS_MAX], velocity[N_MOVLAYERS_MAX];
+  const SessionEvent *event = scene->session;
+  MovLayer *ml;
+  long bytes = 0;
+  int frame;
+  u_char i;
+  for (ml = scene->movLayers, i = 0; ml; ml = movLayerNext(ml), i++) {
+    layerGetPos(movLayerLayer(ml), &start[i]); /* to start the same next time */
+    velocity[i] = ml->velocity;
+  }
+  layerInit(scene->layers);
+  layerGetBounds(scene->layers, &fence);
+  layerDraw(scene->layers);
+  *badFrames = 0;
+  for (frame = 0; frame < N_FRAMES; frame++) {
+    long before;
+    if (event->frame == frame) {
+      for (i = 0; scene->steered[i]; i++) {
+	scene->steered[i]->velocity.axes[0] = event->col;
+	scene->steered[i]->velocity.axes[1] = event->row;
+      }
+      event++;
+    }
+    advance(scene->movLayers);
+    before = hostLcdBytes;
+    draw(scene->movLayers, scene->layers);
+    bytes += hostLcdBytes - before;
+    memcpy(drawn, hostScreen, sizeof drawn);
+    layerDraw(scene->layers);
+    if (memcmp(drawn, hostScreen, sizeof drawn))
+      (*badFrames)++;
+  }
+  for (ml = scene->movLayers, i = 0; ml; ml = movLayerNext(ml), i++) {
+    movLayerLayer(ml)->pos = start[i];
+    ml->velocity = velocity[i];
+  }
+  return bytes;
+}
+
+int
+main()
+{
+  long previous, planned, previousTotal = 0, plannedTotal = 0;
+  u_int previousBad, plannedBad, bad = 0;
+  u_char s;
+  int r, col = 10;
+  for (r = 0; r <= 10; r++) {	/* chords of a circle of radius 10 */
+    while (col * col + r * r > 100)
+      col--;
+    chords10[r] = col;
+  }
+  for (s = 0; s < N_SCENES; s++) {
+    RedrawStats before = redrawStats;
+    previous = replay(&scenes[s], previousDraw, &previousBad);
+    planned = replay(&scenes[s], movLayerDraw, &plannedBad);
+    printf("replayRedraw: %s, %d frames: %ld bytes before, %ld with plans "
+	   "(union %u, delta %u, merged %u frames), %u + %u bad frames\n",
+	   scenes[s].name, N_FRAMES, previous, planned,
+	   redrawStats.frames[REDRAW_UNION] - before.frames[REDRAW_UNION],
+	   redrawStats.frames[REDRAW_DELTA] - before.frames[REDRAW_DELTA],
+	   redrawStats.frames[REDRAW_MERGED] - before.frames[REDRAW_MERGED],
+	   previousBad, plannedBad);
+    previousTotal += previous;
+    plannedTotal += planned;
+    bad += previousBad + plannedBad + (planned > previous);
+  }
+  printf("replayRedraw: %ld bytes before, %ld with plans\n", previousTotal, plannedTotal);
+  return bad || plannedTotal >= previousTotal;
+}
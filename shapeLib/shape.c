@@ -1,4 +1,5 @@
 #include "shape.h"
+#include "shapekernels.h"
 
 const Vec2 screenSize = {screenWidth, screenHeight};
 const Vec2 screenCenter= {screenWidth/2, screenHeight/2};
@@ -22,3 +23,32 @@ abShapeCheck(const AbShape *s, const Vec2 *centerPos, const Vec2 *pixelLoc)
   return (*s->check)(s, centerPos, pixelLoc);
 }
 
+
+u_char
+abShapeKind(const AbShape *s)
+{
+  void *check = (void *)s->check;
+#define SHAPE_KIND_MATCH(kind, type, checkFn, kernel) \
+  if (check == (void *)checkFn) return kind;
+  SHAPE_KINDS(SHAPE_KIND_MATCH)
+#undef SHAPE_KIND_MATCH
+  return SHAPE_USER;
+}
+
+int
+abShapeRun(const AbShape *s, const Vec2 *centerPos, const Vec2 *pixelLoc, int *runEnd)
+{
+  if (shapeCache) {
+    int covered = shapeCacheRun(shapeCache, s, centerPos, pixelLoc, runEnd);
+    if (covered >= 0)
+      return covered;
+  }
+  switch (abShapeKind(s)) {
+#define SHAPE_KIND_CASE(kind, type, check, kernel)			\
+  case kind: return kernel((const type *)s, centerPos, pixelLoc, runEnd);
+  SHAPE_KINDS(SHAPE_KIND_CASE)
+#undef SHAPE_KIND_CASE
+  }
+  *runEnd = pixelLoc->axes[0];	/* no fast path: one pixel at a time */
+  return (*s->check)(s, centerPos, pixelLoc);
+}
@@ -58,6 +58,12 @@ typedef struct {
  */
 void regionUnion(Region *rUnion, const Region *r1, const Region *r2);
 
+/** Computes the overlap of two regions.
+ *
+ *  \return True (1) if the regions overlap; rInter is then their intersection
+ */
+int regionIntersect(Region *rInter, const Region *r1, const Region *r2);
+
 /** Clip region within screen bounds
  */
 void regionClipScreen(Region *region);
@@ -102,6 +108,20 @@ void abShapeGetBounds(const AbShape *s, const Vec2 *centerPos, Region *bounds);
  */
 int abShapeCheck(const AbShape *shape, const Vec2 *centerPos, const Vec2 *pixelLoc);
 
+/** Run end meaning "through the end of the row" */
+#define RUN_END_MAX 0x7fff
+
+/** Row-span query used by the compositor
+ *
+ *  Like abShapeCheck(), but also reports how far along pixelLoc's row
+ *  the answer stays the same.  Shapes without a span fast path report
+ *  a run of one pixel.
+ *
+ *  \param runEnd (out) Last column (>= pixelLoc's) with the same answer
+ *  \return True (1) if pixel is in the abShape centered at centerPos 
+ */
+int abShapeRun(const AbShape *shape, const Vec2 *centerPos, const Vec2 *pixelLoc, int *runEnd);
+
 /** An AbShape Right Arrow with filled tip
  *
  *  size: width of the arrow.  Tip is a triangle with width=1/2 size.
@@ -121,6 +141,10 @@ void abRArrowGetBounds(const AbRArrow *arrow, const Vec2 *centerPos, Region *bou
  */
 int abRArrowCheck(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Row-span fast path, see abShapeRun()
+ */
+int abRArrowRun(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
 /** AbShape rectangle
  *
  *  Vector halfSize must be to first quadrant (both axes non-negative).  
@@ -140,6 +164,10 @@ void abRectGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *bounds);
  */
 int abRectCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Row-span fast path, see abShapeRun()
+ */
+int abRectRun(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
 typedef AbRect AbRectOutline;	/* same as AbRect */
 
 /** As required by AbShape
@@ -150,6 +178,425 @@ void abRectOutlineGetBounds(const AbRect *rect, const Vec2 *centerPos, Region *b
  */
 int abRectOutlineCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel);
 
+/** Row-span fast path, see abShapeRun()
+ */
+int abRectOutlineRun(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** AbShape circle
+ *  
+ *  chords should be a vector of length radius + 1.  
+ *  Entry at index i is 1/2 chord length at distance i from the circle's center.  
+ *  circleLib provides chord vectors and circles of radius 2 to 150 (abCircle.h).
+ */ 
+typedef struct AbCircle_s {
+  void (*getBounds)(const struct AbCircle_s *circle, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbCircle_s *circle, const Vec2 *centerPos, const Vec2 *pixel);
+  const u_char *chords;
+  const u_char radius;
+} AbCircle;
+
+/** Required by AbShape
+ */
+void abCircleGetBounds(const AbCircle *circle, const Vec2 *circlePos, Region *bounds);
+
+/** Required by AbShape
+ */
+int abCircleCheck(const AbCircle *circle, const Vec2 *circlePos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abCircleRun(const AbCircle *circle, const Vec2 *circlePos, const Vec2 *pixel, int *runEnd);
+
+/** AbShape filled ellipse
+ *
+ *  chords should be a vector of length rowRadius + 1.
+ *  Entry at index i is 1/2 the width of the row at distance i from the
+ *  ellipse's center (so chords[0] == colRadius).
+ *  circleLib's makeCircles generates ellipses listed in its ellipses[] table.
+ */
+typedef struct AbEllipse_s {
+  void (*getBounds)(const struct AbEllipse_s *ellipse, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbEllipse_s *ellipse, const Vec2 *centerPos, const Vec2 *pixel);
+  const u_char *chords;
+  u_char colRadius, rowRadius;
+} AbEllipse;
+
+/** Required by AbShape
+ */
+void abEllipseGetBounds(const AbEllipse *ellipse, const Vec2 *centerPos, Region *bounds);
+
+/** Required by AbShape
+ */
+int abEllipseCheck(const AbEllipse *ellipse, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abEllipseRun(const AbEllipse *ellipse, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** AbShape ring: the pixels of an outer disc that are not in an inner one
+ *
+ *  outer & inner are chord vectors indexed by row like an AbEllipse's,
+ *  of length outerRadius + 1 and innerRadius + 1.  circleLib's
+ *  rowChordVecN (circle N's chordVec transposed to rows) and generated
+ *  ellipse chords can be used for either.
+ *  innerRadius must be less than outerRadius.
+ *  circleLib's makeCircles generates annuli listed in its annuli[] table.
+ */
+typedef struct AbAnnulus_s {
+  void (*getBounds)(const struct AbAnnulus_s *annulus, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbAnnulus_s *annulus, const Vec2 *centerPos, const Vec2 *pixel);
+  const u_char *outer, *inner;
+  u_char outerRadius, innerRadius;
+} AbAnnulus;
+
+/** Required by AbShape
+ */
+void abAnnulusGetBounds(const AbAnnulus *annulus, const Vec2 *centerPos, Region *bounds);
+
+/** Required by AbShape
+ */
+int abAnnulusCheck(const AbAnnulus *annulus, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abAnnulusRun(const AbAnnulus *annulus, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** AbShape backed by a 1-bit-per-pixel mask, usually in flash
+ *
+ *  Row r of the mask is the (1 << rowShift) bytes at bits + (r << rowShift),
+ *  most significant bit leftmost.  rowFirst[r] & rowLast[r] are the first
+ *  and last set columns of row r (rowFirst > rowLast for an empty row).
+ *  Mask pixel (centerCol, centerRow) is drawn at centerPos.
+ *
+ *  makeBitmaps generates AbBitmaps from the check functions of other shapes.
+ */
+typedef struct AbBitmap_s {
+  void (*getBounds)(const struct AbBitmap_s *bitmap, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbBitmap_s *bitmap, const Vec2 *centerPos, const Vec2 *pixel);
+  u_char width, height;
+  u_char centerCol, centerRow;
+  u_char rowShift;
+  const u_char *bits;
+  const u_char *rowFirst, *rowLast;
+} AbBitmap;
+
+/** As required by AbShape
+ */
+void abBitmapGetBounds(const AbBitmap *bitmap, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abBitmapCheck(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abBitmapRun(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** Vertex of an AbConvexPoly, relative to its center.
+ *  Both coordinates must be within -63..63.
+ */
+typedef struct {
+  signed char col, row;
+} PolyVertex;
+
+/** Where one edge crosses the row being drawn: the edge function
+ *  (positive inside) at column col, the first (or last) column inside.
+ */
+typedef struct {
+  int e, col;
+} PolyEdge;
+
+/** Working state of an AbConvexPoly, in RAM */
+typedef struct {
+  PolyEdge *edges;
+  char ready;			/* bounds & orientation are set */
+  char reversed;		/* vertices run counterclockwise on screen */
+  char rowValid;		/* edges are stepped to row */
+  int row;
+  Region bounds;		/* of the vertices */
+} PolyState;
+
+/** AbShape convex polygon
+ *
+ *  Vertices may be listed in either direction.  Rows are drawn as spans
+ *  by stepping each edge's function from row to row with additions only
+ *  (there is no hardware multiplier).  The edges are stepped for one row
+ *  at a time, so a polygon drawn at several places should have an
+ *  AbConvexPoly (and state) per place; they can share vertices.
+ *  Declare with AB_CONVEX_POLY or AB_TRIANGLE.
+ */
+typedef struct AbConvexPoly_s {
+  void (*getBounds)(const struct AbConvexPoly_s *poly, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbConvexPoly_s *poly, const Vec2 *centerPos, const Vec2 *pixel);
+  const PolyVertex *vertices;
+  u_char n;
+  PolyState *state;
+} AbConvexPoly;
+
+typedef AbConvexPoly AbTriangle;	/* with 3 vertices */
+
+/** Declares AbConvexPoly name with the n vertices */
+#define AB_CONVEX_POLY(name, vertices, n)				\
+  PolyEdge name##Edges[n];						\
+  PolyState name##State = {name##Edges};				\
+  const AbConvexPoly name = {abConvexPolyGetBounds, abConvexPolyCheck,	\
+			     vertices, n, &name##State}
+
+/** Declares AbTriangle name with vertices (c0,r0), (c1,r1), (c2,r2) */
+#define AB_TRIANGLE(name, c0, r0, c1, r1, c2, r2)			\
+  const PolyVertex name##Vertices[3] = {{c0, r0}, {c1, r1}, {c2, r2}};	\
+  AB_CONVEX_POLY(name, name##Vertices, 3)
+
+/** As required by AbShape
+ */
+void abConvexPolyGetBounds(const AbConvexPoly *poly, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abConvexPolyCheck(const AbConvexPoly *poly, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abConvexPolyRun(const AbConvexPoly *poly, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** Position of one instance, relative to the AbInstances' centerPos */
+typedef struct {
+  u_char col, row;
+} InstancePos;
+
+/** Working state of an AbInstances, in RAM.
+ *
+ *  While a frame is composited row by row, active lists the instances
+ *  whose bounds include the current row, sorted by column.  Instances
+ *  enter it in order of their row, from order.
+ */
+typedef struct {
+  u_char *order;		/* instances sorted by row */
+  u_char *active;		/* instances on row, sorted by column */
+  u_char count;			/* instances in use */
+  u_char activeCount, nextOrder;
+  char sorted;			/* order is up to date */
+  int row;			/* row active was built for */
+  Vec2 centerPos;		/* centerPos active was built for */
+  Region shapeBounds;		/* of abShape, relative to its center */
+} InstanceList;
+
+/** AbShape drawing one shape at many positions
+ *
+ *  A layer whose shape is an AbInstances draws abShape, in the layer's
+ *  color, at centerPos + positions[i] for each of list->count instances.
+ *  The compositor only probes the instances on the row being drawn, in
+ *  column order, instead of one layer per instance.  Declare with
+ *  AB_INSTANCES and call abInstancesMoved() after changing positions
+ *  or count.
+ */
+typedef struct AbInstances_s {
+  void (*getBounds)(const struct AbInstances_s *inst, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbInstances_s *inst, const Vec2 *centerPos, const Vec2 *pixel);
+  const AbShape *abShape;
+  InstancePos *positions;
+  InstanceList *list;
+} AbInstances;
+
+/** Declares AbInstances name drawing shape at each of the n positions */
+#define AB_INSTANCES(name, shape, positions, n)			\
+  u_char name##Order[n], name##Active[n];				\
+  InstanceList name##List = {name##Order, name##Active, n};		\
+  const AbInstances name = {abInstancesGetBounds, abInstancesCheck,	\
+			    (const AbShape *)(shape), positions, &name##List}
+
+/** As required by AbShape: the union of all instances' bounds
+ */
+void abInstancesGetBounds(const AbInstances *inst, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape
+ */
+int abInstancesCheck(const AbInstances *inst, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abInstancesRun(const AbInstances *inst, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** To be called after changing inst's positions or count
+ */
+void abInstancesMoved(const AbInstances *inst);
+
+/** AbTransform orientations: flips of the view's columns and rows,
+ *  then a swap of the axes.  Rotations are clockwise on screen.
+ */
+#define TRANSFORM_FLIP_H 1		/* mirror left-right */
+#define TRANSFORM_FLIP_V 2		/* mirror top-bottom */
+#define TRANSFORM_SWAP 4		/* mirror along the main diagonal */
+#define TRANSFORM_ROT_90 (TRANSFORM_SWAP | TRANSFORM_FLIP_H)
+#define TRANSFORM_ROT_180 (TRANSFORM_FLIP_H | TRANSFORM_FLIP_V)
+#define TRANSFORM_ROT_270 (TRANSFORM_SWAP | TRANSFORM_FLIP_V)
+
+/** AbShape drawing another shape rotated, mirrored and moved
+ *
+ *  abShape is drawn turned by orient (TRANSFORM_*) about its own center,
+ *  which is placed at centerPos + offset.  Nothing is copied: pixels are
+ *  mapped back into abShape's check and span paths, so one shape (a
+ *  bitmap in flash, a chord table) serves all eight orientations.
+ *
+ *  Orientations without TRANSFORM_SWAP keep abShape's rows as rows and
+ *  draw at about its own span cost.  With TRANSFORM_SWAP a row of the
+ *  view is a column of abShape, checked pixel by pixel; register such
+ *  views in the shape cache if they are large or drawn often.
+ *  abShape's bounds are taken at screenCenter, so shapes that clip
+ *  their bounds to the screen should be no larger than half of it.
+ */
+typedef struct AbTransform_s {
+  void (*getBounds)(const struct AbTransform_s *transform, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbTransform_s *transform, const Vec2 *centerPos, const Vec2 *pixel);
+  const AbShape *abShape;
+  u_char orient;
+  Vec2 offset;
+} AbTransform;
+
+/** Required by AbShape
+ */
+void abTransformGetBounds(const AbTransform *transform, const Vec2 *centerPos, Region *bounds);
+
+/** Required by AbShape
+ */
+int abTransformCheck(const AbTransform *transform, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun()
+ */
+int abTransformRun(const AbTransform *transform, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** Registry of the built-in shape kinds: X(kind, type, check, kernel)
+ *
+ *  A shape's kind is found from its check function by abShapeKind().
+ *  Code that probes many pixels looks it up once and then switches on
+ *  it, calling the kernels (shapekernels.h) directly; shapes of other
+ *  kinds (SHAPE_USER) go through their check pointer.
+ */
+#define SHAPE_KINDS(X)							\
+  X(SHAPE_RECT, AbRect, abRectCheck, rectKernel)			\
+  X(SHAPE_RECT_OUTLINE, AbRectOutline, abRectOutlineCheck, rectOutlineKernel) \
+  X(SHAPE_RARROW, AbRArrow, abRArrowCheck, rarrowKernel)		\
+  X(SHAPE_CIRCLE, AbCircle, abCircleCheck, circleKernel)		\
+  X(SHAPE_ELLIPSE, AbEllipse, abEllipseCheck, ellipseKernel)	\
+  X(SHAPE_ANNULUS, AbAnnulus, abAnnulusCheck, annulusKernel)	\
+  X(SHAPE_BITMAP, AbBitmap, abBitmapCheck, bitmapKernel)		\
+  X(SHAPE_CONVEX_POLY, AbConvexPoly, abConvexPolyCheck, abConvexPolyRun) \
+  X(SHAPE_INSTANCES, AbInstances, abInstancesCheck, abInstancesRun) \
+  X(SHAPE_TRANSFORM, AbTransform, abTransformCheck, abTransformRun) \
+  X(SHAPE_GROUP, AbGroup, abGroupCheck, abGroupRun)
+
+#define SHAPE_KIND_ENUM(kind, type, check, kernel) kind,
+enum {SHAPE_USER, SHAPE_KINDS(SHAPE_KIND_ENUM) SHAPE_KIND_COUNT};
+#undef SHAPE_KIND_ENUM
+
+/** Returns the kind of s: one of SHAPE_KINDS, or SHAPE_USER
+ */
+u_char abShapeKind(const AbShape *s);
+
+/** Shape cache: opt-in memoization of expensive shapes.
+ *
+ *  A registered AbShape is sampled once, relative to its center, into
+ *  a per-row list of runs in the cache's arena.  abShapeRun() then
+ *  answers from those runs at any position, so shapes must look the
+ *  same wherever they are drawn.  When the arena is full the least
+ *  recently used shapes are evicted; they are sampled again when next
+ *  drawn.  Shapes used by the draw in progress are never evicted: a
+ *  shape that does not fit then is checked pixel by pixel until the
+ *  next draw.  Changes to a shape's fields are not detected, see
+ *  shapeCacheInvalidate().
+ */
+typedef struct {
+  const AbShape *abShape;
+  u_int offset, size;		/* of its runs in the arena, size 0 if not sampled */
+  u_int lastUse;		/* clock of the last draw using it */
+  char tooBig;			/* can never fit: always use check */
+  char noRoom;			/* did not fit during draw lastUse */
+} ShapeCacheEntry;
+
+typedef struct {
+  u_char *arena;
+  u_int arenaSize, arenaUsed;
+  ShapeCacheEntry *entries;
+  u_char entryMax, entryCount;
+  u_int clock;			/* counts draws, for LRU */
+  u_int misses, evictions;
+} ShapeCache;
+
+/** Declares a ShapeCache of nBytes with room for nShapes shapes */
+#define SHAPE_CACHE(name, nBytes, nShapes)		\
+  u_char name##Arena[nBytes];				\
+  ShapeCacheEntry name##Entries[nShapes];		\
+  ShapeCache name = {name##Arena, nBytes, 0, name##Entries, nShapes}
+
+/** The cache abShapeRun() consults, 0 (the default) for none */
+extern ShapeCache *shapeCache;
+
+/** Starts a new draw for the LRU; called by the compositor */
+#define shapeCacheTick() (shapeCache ? shapeCache->clock++ : 0)
+
+/** Registers s with cache.  Returns false if cache has no free entry. 
+ */
+int shapeCacheAdd(ShapeCache *cache, const AbShape *s);
+
+/** Drops the runs of s (after changing its fields), or of every
+ *  shape when s is 0.  Shapes stay registered.
+ */
+void shapeCacheInvalidate(ShapeCache *cache, const AbShape *s);
+
+/** True if s is registered with cache
+ */
+int shapeCacheHas(ShapeCache *cache, const AbShape *s);
+
+/** abShapeRun() from the cache.  Returns -1 if s is not registered.
+ */
+int shapeCacheRun(ShapeCache *cache, const AbShape *s, const Vec2 *centerPos,
+		  const Vec2 *pixelLoc, int *runEnd);
+
+/** abShapeCheck() from the cache.  Returns -1 if s is not registered.
+ */
+int shapeCacheCheck(ShapeCache *cache, const AbShape *s, const Vec2 *centerPos,
+		    const Vec2 *pixelLoc);
+
+/** Layer layouts.  shapeLib and the programs using it must be built
+ *  with the same -DLAYER_LAYOUT=...
+ *
+ *  LAYER_LAYOUT_RAM: every field of a Layer or MovLayer is in RAM.
+ *  LAYER_LAYOUT_FLASH: what never changes (shape, color, initial
+ *  position and z-order) is kept in a const descriptor in flash; only
+ *  positions, velocities and the bake reference stay in RAM.  Layers
+ *  must then be declared with LAYER() and MOVLAYER().
+ *  LAYER_LAYOUT_COMPACT: a Layer is packed into 12 bytes of RAM:
+ *  u_char coordinates (0..255) with signed char offsets to the last and
+ *  next positions (-128..127), and links that are indices into the
+ *  application's layerArena[].  Layers must be declared in layerArena[]
+ *  with LAYER_AT(); static layers cannot be baked.
+ */
+#define LAYER_LAYOUT_RAM     0
+#define LAYER_LAYOUT_FLASH   1
+#define LAYER_LAYOUT_COMPACT 2
+
+#define LAYER_NONE 0xff		/* layerArena[] index that ends a list */
+
+/** With LAYER_PALETTE defined (always, in the compact layout) a layer's 
+ *  color is an index into the active palette (see paletteSet()) rather
+ *  than a BGR value, so its color can be animated by switching palettes.
+ */
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT && !defined(LAYER_PALETTE)
+#define LAYER_PALETTE
+#endif
+
+#ifdef LAYER_PALETTE
+typedef u_char LayerColor;
+#define layerColorBGR(c) paletteColor(c)
+#else
+typedef u_int LayerColor;
+#define layerColorBGR(c) (c)
+#endif
+
+#ifndef LAYER_LAYOUT
+#define LAYER_LAYOUT LAYER_LAYOUT_RAM
+#endif
+
 /** Linked list of Layers.  
  * 
  *  Each layer contains
@@ -157,14 +604,162 @@ int abRectOutlineCheck(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pi
  *   - the layer's current position
  *   - the layer's color
  *   - a reference to the next (lower) layer.
+ *   - optionally, the runs its shape was baked into (see layerBake())
+ *
+ *  Library code reads the shape, color and next layer through
+ *  layerShape(), layerColor() and layerNext(), and copies positions
+ *  in and out with layerGetPos(), layerGetPosLast(), layerGetPosNext()
+ *  and layerSetPosNext(), so that it works with any layout.
  */
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+
+/** The immutable part of a Layer */
+typedef struct LayerDesc_s {
+  const AbShape *abShape;
+  LayerColor color;
+  Vec2 posInit;			/* copied to pos by layerInit() */
+  struct Layer_s *next;
+} LayerDesc;
+
+typedef struct Layer_s {
+  const LayerDesc *desc;
+  Vec2 pos, posLast, posNext;	/* set by layerInit() */
+  struct LayerBake_s *bake;	/* 0 unless the layer is static */
+} Layer;
+
+#define layerShape(l) ((l)->desc->abShape)
+#define layerColor(l) ((l)->desc->color)
+#define layerNext(l)  ((l)->desc->next)
+#define layerBakeOf(l) ((l)->bake)
+
+/** Declares Layer name in RAM with its descriptor in flash */
+#define LAYER(name, shape, color, col, row, next)			\
+  static const LayerDesc name##Desc = {					\
+    (const AbShape *)(shape), color, {col, row}, next};			\
+  Layer name = {&name##Desc}
+
+#elif LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+
+typedef struct Layer_s {
+  const AbShape *abShape;
+  u_char col, row;		/* pos */
+  signed char lastCol, lastRow;	/* posLast - pos */
+  signed char nextCol, nextRow;	/* posNext - pos */
+  LayerColor color;		/* palette index */
+  u_char next;			/* index into layerArena[] or LAYER_NONE */
+  u_char flags;			/* free for the application */
+} Layer;
+
+extern Layer layerArena[];	/* defined by the application */
+
+#define layerShape(l) ((l)->abShape)
+#define layerColor(l) ((l)->color)
+#define layerNext(l)  ((l)->next == LAYER_NONE ? (Layer *)0 : &layerArena[(l)->next])
+#define layerBakeOf(l) ((struct LayerBake_s *)0)
+
+#define layerGetPos(l, v)						\
+  ((v)->axes[0] = (l)->col, (v)->axes[1] = (l)->row)
+#define layerGetPosLast(l, v)						\
+  ((v)->axes[0] = (l)->col + (l)->lastCol, (v)->axes[1] = (l)->row + (l)->lastRow)
+#define layerGetPosNext(l, v)						\
+  ((v)->axes[0] = (l)->col + (l)->nextCol, (v)->axes[1] = (l)->row + (l)->nextRow)
+#define layerSetPosNext(l, v)						\
+  ((l)->nextCol = (v)->axes[0] - (l)->col, (l)->nextRow = (v)->axes[1] - (l)->row)
+
+/** Entry idx of layerArena[]; next is an index or LAYER_NONE */
+#define LAYER_AT(idx, shape, color, col, row, next)		\
+  [idx] = {(const AbShape *)(shape), col, row, 0, 0, 0, 0, color, next}
+
+#else
+
 typedef struct Layer_s {
   AbShape *abShape;
   Vec2 pos, posLast, posNext; /* initially just set pos */
-  u_int color;
+  LayerColor color;
   struct Layer_s *next;
+  struct LayerBake_s *bake;	/* 0 unless the layer is static */
 } Layer;	
 
+#define layerShape(l) ((const AbShape *)(l)->abShape)
+#define layerColor(l) ((l)->color)
+#define layerNext(l)  ((l)->next)
+#define layerBakeOf(l) ((l)->bake)
+
+#define LAYER(name, shape, color, col, row, next)			\
+  Layer name = {(AbShape *)(shape), {col, row}, {0,0}, {0,0}, color, next}
+
+/** Entry idx of an application-defined layerArena[] */
+#define LAYER_AT(idx, shape, color, col, row, next)			\
+  [idx] = {(AbShape *)(shape), {col, row}, {0,0}, {0,0}, color,		\
+	   (next) == LAYER_NONE ? (Layer *)0 : &layerArena[next]}
+
+#endif
+
+#if LAYER_LAYOUT != LAYER_LAYOUT_COMPACT
+#define layerGetPos(l, v)     (*(v) = (l)->pos)
+#define layerGetPosLast(l, v) (*(v) = (l)->posLast)
+#define layerGetPosNext(l, v) (*(v) = (l)->posNext)
+#define layerSetPosNext(l, v) ((l)->posNext = *(v))
+#endif
+
+/** Columns colStart..colEnd of a row covered by a baked shape */
+typedef struct {
+  u_char colStart, colEnd;
+} LayerRun;
+
+/** Rows rowStart..rowEnd of a baked shape that share the same runs */
+typedef struct {
+  u_char rowStart, rowEnd;
+  u_char firstRun, runCount;	/* index into LayerBake.runs */
+} LayerBand;
+
+/** A static layer's coverage, baked into bands of per-row runs.
+ *
+ *  Storage is provided by the caller, usually via LAYER_BAKE.  A bake is
+ *  redone when the layer's abShape or position changes; changes made
+ *  to the AbShape's own fields are not detected.
+ */
+typedef struct LayerBake_s {
+  LayerBand *bands;
+  u_char bandMax;
+  LayerRun *runs;
+  u_char runMax;
+  u_char bandCount, runCount;
+  u_char band;			/* cursor: band of the last row looked up */
+  char valid;			/* false if the shape did not fit */
+  const AbShape *abShape;	/* what was baked */
+  Vec2 pos;
+} LayerBake;
+
+/** Declares a LayerBake with room for nBands bands and nRuns runs */
+#define LAYER_BAKE(name, nBands, nRuns)			\
+  LayerBand name##Bands[nBands];			\
+  LayerRun name##Runs[nRuns];				\
+  LayerBake name = {name##Bands, nBands, name##Runs, nRuns}
+
+/** Marks l static and bakes its shape at its current position into bake.
+ *
+ *  The compositor then looks pixels up in the runs instead of calling
+ *  the shape's check function.
+ *
+ *  \return True (1) if the shape fit in bake's storage.  Otherwise the
+ *  layer keeps using its check function.
+ */
+int layerBake(Layer *l, LayerBake *bake);
+
+/** Re-bakes the static layers in the list whose shape or position
+ *  changed.  Called by the compositor before it draws.
+ */
+void layerBakeRefresh(Layer *layers);
+
+/** True (1) if layer l covers pixel, using its baked runs if it has any 
+ */
+int layerCheck(Layer *l, const Vec2 *pixel);
+
+/** Row-span version of layerCheck(), see abShapeRun()
+ */
+int layerRun(Layer *l, const Vec2 *pixel, int *runEnd);
+
 /** Compute layer's bounding box.
  */
 void layerGetBounds(const Layer *l, Region *bounds);
@@ -174,11 +769,675 @@ void layerGetBounds(const Layer *l, Region *bounds);
  */
 void layerInit(Layer *layers);
 
+/** Moves a layer to its next position, remembering the current one as
+ *  its last position.
+ */
+void layerCommitPos(Layer *l);
+
 /** Render all layers.   
- *  Pixels that are not contained by a layer are set to bgColor.
+ *  Pixels that are not contained by a layer are set to the background:
+ *  tileMap's tile pixel if there is one, else bgColor (a BGR value even
+ *  with LAYER_PALETTE).
  */
 void layerDraw(Layer *layers);
 
+/** Render all layers within region (clipped to the screen).
+ *
+ *  The region is written through a single LCD address window.  Each
+ *  pixel takes the color of the first layer that contains it, or the
+ *  background if none does.
+ */
+void layerDrawRegion(Layer *layers, const Region *region);
+
+/** A resumable layerDrawRegion().
+ *
+ *  Long redraws can be spread over several passes of the main loop (or
+ *  ticks of a scheduler) so that input, sound and physics keep running.
+ *  A zero-initialized job is done.
+ */
+typedef struct {
+  Layer *layers;
+  Region region;		/* clipped to the screen */
+  int row;			/* next row to render */
+  int rowsLeft;			/* 0 once the job is done */
+} LayerDrawJob;
+
+/** Starts rendering layers within region.  Nothing is drawn until 
+ *  layerDrawStep() is called.
+ */
+void layerDrawBegin(LayerDrawJob *job, Layer *layers, const Region *region);
+
+/** Renders at most rows more rows of the job.
+ *
+ *  \param rows The per-slice budget
+ *  \return True (1) once the whole region has been rendered
+ */
+int layerDrawStep(LayerDrawJob *job, int rows);
+
+/** True (1) if the job has no rows left to render
+ */
+int layerDrawDone(const LayerDrawJob *job);
+
+/** Tile-map background
+ *
+ *  The screen behind the layers is a grid of cols x rows tiles of
+ *  TILE_SIZE x TILE_SIZE pixels with its top-left pixel at origin;
+ *  pixels outside it are bgColor.  map (in RAM) holds each cell's tile
+ *  number, row by row.  Tile t's pixels are the 32 bytes at
+ *  tiles + (t << 5) (usually in flash): 4 bytes per row, two pixels per
+ *  byte, left pixel in the high nibble.  Each nibble is an index into
+ *  the active palette, offset by paletteBase.
+ *
+ *  Change cells with tileMapSet(), which marks them dirty, and draw the
+ *  dirty cells with tileMapRedraw().  Declare with TILE_MAP and point
+ *  tileMap at it.
+ */
+#define TILE_SHIFT 3
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_BYTES 32			/* 4 bits per pixel */
+
+typedef struct {
+  const u_char *tiles;
+  u_char *map;			/* cols * rows tile numbers */
+  u_char *dirty;		/* one bit per cell */
+  u_char cols, rows;
+  Vec2 origin;
+  u_char paletteBase;
+} TileMap;
+
+/** Declares TileMap name of cols x rows cells of tiles, with its top-left
+ *  pixel at (col, row)
+ */
+#define TILE_MAP(name, tiles, cols, rows, col, row, paletteBase)	\
+  u_char name##Map[(cols) * (rows)];					\
+  u_char name##Dirty[((cols) * (rows) + 7) / 8];			\
+  TileMap name = {tiles, name##Map, name##Dirty, cols, rows, {col, row}, paletteBase}
+
+/** The background drawn by the compositor, 0 for bgColor */
+extern TileMap *tileMap;
+
+/** Where a screen row crosses a tile map, set up once per row */
+typedef struct {
+  const TileMap *map;
+  const u_char *mapRow;		/* the row's cells, 0 outside the map */
+  u_char tileRow;		/* byte offset of the pixel row in a tile */
+} TileCursor;
+
+/** Sets cursor up for screen row row of map */
+void tileMapRow(const TileMap *map, int row, TileCursor *cursor);
+
+/** Writes columns colStart..colEnd of cursor's row to the LCD */
+void tileMapWrite(const TileCursor *cursor, int colStart, int colEnd);
+
+/** Sets cell (col, row) of map to tile, marking it dirty if it changed */
+void tileMapSet(TileMap *map, u_char col, u_char row, u_char tile);
+
+/** Marks every cell of map dirty */
+void tileMapDirtyAll(TileMap *map);
+
+/** Redraws map's dirty cells, compositing layers over them */
+void tileMapRedraw(TileMap *map, Layer *layers);
+
+/** Working state of an AbGroup, in RAM */
+typedef struct {
+  Region bounds;		/* union of the children's, relative to the group */
+  char boundsValid;
+  Layer *hit;			/* child found by the last check or run */
+} GroupState;
+
+/** AbShape made of a list of child layers, moved as one
+ *
+ *  A layer whose shape is an AbGroup draws children, each in its own
+ *  color and in list order, at the group layer's position plus the
+ *  child's own (in the compact layout, child positions are signed
+ *  char offsets).  Moving the group layer moves all of them.  The
+ *  union of the children's bounds is cached, so the compositor skips a
+ *  whole group with one bounds test on rows and columns it does not
+ *  reach.  Call abGroupChanged() after moving a child or changing its
+ *  shape.
+ *
+ *  Each AbGroup can be used by one layer at a time.  Groups can be
+ *  nested, but must not be baked or put in the shape cache: their
+ *  coverage alone does not say which child's color to draw.
+ *  Children's bounds are taken at screenCenter, like AbTransform's.
+ */
+typedef struct AbGroup_s {
+  void (*getBounds)(const struct AbGroup_s *group, const Vec2 *centerPos, Region *bounds);
+  int (*check)(const struct AbGroup_s *group, const Vec2 *centerPos, const Vec2 *pixel);
+  Layer *children;
+  GroupState *state;
+} AbGroup;
+
+/** Declares AbGroup name of the layer list children */
+#define AB_GROUP(name, children)					\
+  GroupState name##State;						\
+  const AbGroup name = {abGroupGetBounds, abGroupCheck, children, &name##State}
+
+/** As required by AbShape: the union of the children's bounds
+ */
+void abGroupGetBounds(const AbGroup *group, const Vec2 *centerPos, Region *bounds);
+
+/** As required by AbShape; the covering child is left in state->hit
+ */
+int abGroupCheck(const AbGroup *group, const Vec2 *centerPos, const Vec2 *pixel);
+
+/** Row-span fast path, see abShapeRun(); sets state->hit like abGroupCheck()
+ */
+int abGroupRun(const AbGroup *group, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** To be called after moving one of group's children or changing its shape
+ */
+void abGroupChanged(const AbGroup *group);
+
+/** The layer whose color shows where l covers a pixel just probed:
+ *  the child found in l's group, or l itself
+ */
+#define layerHit(l)							\
+  ((void *)layerShape(l)->check == (void *)abGroupCheck ?		\
+   ((const AbGroup *)layerShape(l))->state->hit : (l))
+
+/** Moving Layer
+ *  Linked list of layer references
+ *  Velocity represents one iteration of change (direction & magnitude)
+ *
+ *  Read the layer and next moving layer through movLayerLayer() and
+ *  movLayerNext().
+ */
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+
+/** The immutable part of a MovLayer */
+typedef struct MovLayerDesc_s {
+  Layer *layer;
+  struct MovLayer_s *next;
+} MovLayerDesc;
+
+typedef struct MovLayer_s {
+  const MovLayerDesc *desc;
+  Vec2 velocity;
+} MovLayer;
+
+#define movLayerLayer(ml) ((ml)->desc->layer)
+#define movLayerNext(ml)  ((ml)->desc->next)
+
+/** Declares MovLayer name in RAM with its descriptor in flash */
+#define MOVLAYER(name, layer, vcol, vrow, next)			\
+  static const MovLayerDesc name##Desc = {layer, next};		\
+  MovLayer name = {&name##Desc, {vcol, vrow}}
+
+#else
+
+typedef struct MovLayer_s {
+  Layer *layer;
+  Vec2 velocity;
+  struct MovLayer_s *next;
+} MovLayer;
+
+#define movLayerLayer(ml) ((ml)->layer)
+#define movLayerNext(ml)  ((ml)->next)
+
+#define MOVLAYER(name, layer, vcol, vrow, next)	\
+  MovLayer name = {layer, {vcol, vrow}, next}
+
+#endif
+
+/** Redraw plans considered by movLayerDraw() */
+enum {
+  REDRAW_UNION,			/* each moving layer's old & new bounds */
+  REDRAW_DELTA,			/* only strips that changed, for solid rects */
+  REDRAW_MERGED,		/* one region covering all moving layers */
+  REDRAW_PLANS
+};
+
+/** Counters kept by movLayerDraw()
+ *
+ *  cost holds the estimated cost (roughly CPU cycles, counting SPI bytes,
+ *  address window setups and shape checks) of every plan for the last 
+ *  frame, which explains why plan was chosen.
+ */
+typedef struct {
+  u_int frames[REDRAW_PLANS];	/* frames drawn with each plan */
+  long cost[REDRAW_PLANS];	/* estimates for the last frame */
+  u_char plan;			/* plan chosen for the last frame */
+  long bytes;			/* total SPI bytes sent */
+} RedrawStats;
+
+extern RedrawStats redrawStats;
+
+/** Moves each moving layer to posNext and redraws what changed.
+ *
+ *  The cheapest of the REDRAW_ plans is chosen for every frame.  Layers
+ *  whose posNext is their pos are not redrawn.
+ */
+void movLayerDraw(MovLayer *movLayers, Layer *layers);
+
+/** Q8.8 fixed point: FIX_ONE is one pixel */
+#define FIX_SHIFT 8
+#define FIX_ONE (1 << FIX_SHIFT)
+
+/** Q8.8 constant from a number of pixels, e.g. FIX(0.25) */
+#define FIX(pixels) ((int)((pixels) * FIX_ONE))
+
+/** Subpixel motion of a layer
+ *
+ *  velocity is in Q8.8 pixels per step and accel in Q8.8 pixels per step
+ *  per step; both must stay within +-127 pixels.  frac is the part of
+ *  the position below a pixel, per axis.
+ */
+typedef struct {
+  Layer *layer;
+  Vec2 velocity;
+  Vec2 accel;
+  u_char frac[2];
+} Motion;
+
+/** Declares Motion name for layer, with velocity and acceleration in
+ *  pixels, e.g. MOTION(ball, &ballLayer, 0.5, -2, 0, 0.125)
+ */
+#define MOTION(name, layer, vcol, vrow, acol, arow)			\
+  Motion name = {layer, {FIX(vcol), FIX(vrow)}, {FIX(acol), FIX(arow)}, {0, 0}}
+
+/** Advances the n motions by one step: adds each one's acceleration to
+ *  its velocity and its velocity to its position, carrying whole pixels
+ *  into its layer's posNext.  Several steps can be taken between draws.
+ *  Returns how many layers' posNext changed.
+ */
+u_char motionStep(Motion *motions, u_char n);
+
+/** Handle of a pooled layer: generation << 8 | slot.  Handles of
+ *  despawned layers are refused, even after their slot is reused
+ *  (until the 8-bit generation wraps, 128 reuses later).
+ */
+typedef u_int LayerHandle;
+#define LAYER_HANDLE_NONE 0
+
+/** Fixed-capacity pool of Layers (and MovLayers) spawned at run time
+ *
+ *  Pooled layers form a band at the top of the z-order, above the list
+ *  below; draw layerPoolLayers(pool) and move layerPoolMovLayers(pool).
+ *  Each spawn goes on top of the band, and despawning unlinks a layer
+ *  without disturbing the order of the others, both in constant time.
+ *  Free slots are kept in a list threaded through links[]; there is no
+ *  heap.  Spawn and despawn from the code that draws, not from
+ *  interrupt handlers.
+ *
+ *  The bounds of spawned layers and the last bounds of despawned ones
+ *  are collected into a dirty region.  Draw it with layerPoolRedraw()
+ *  before the frame's movLayerDraw(), which only redraws what moved
+ *  from where a layer was last drawn.
+ *
+ *  Declare with LAYER_POOL or MOVLAYER_POOL (LAYER_POOL_AT or
+ *  MOVLAYER_POOL_AT in the compact layout, where the slots are entries
+ *  base .. base + n - 1 of layerArena[]), then call layerPoolInit().
+ */
+typedef struct {
+  Layer *layers;
+  MovLayer *movLayers;		/* 0 for a pool of static layers */
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+  LayerDesc *layerDescs;	/* in RAM: pooled layers change */
+  MovLayerDesc *movLayerDescs;
+#endif
+  u_char *gens;			/* per slot, odd while in use */
+  u_char *links;		/* in use: slot above (or LAYER_NONE), free: next free */
+  u_char capacity, count;
+  u_char top, free;		/* slots or LAYER_NONE */
+  Layer *below;
+  MovLayer *movBelow;
+  Region dirty;
+  char dirtyValid;
+} LayerPool;
+
+#if LAYER_LAYOUT == LAYER_LAYOUT_FLASH
+#define LAYER_POOL_STORAGE(name, n)				\
+  Layer name##Layers[n];						\
+  LayerDesc name##LayerDescs[n];					\
+  u_char name##Gens[n], name##Links[n]
+#define LAYER_POOL(name, n)						\
+  LAYER_POOL_STORAGE(name, n);						\
+  LayerPool name = {name##Layers, 0, name##LayerDescs, 0,		\
+		    name##Gens, name##Links, n}
+#define MOVLAYER_POOL(name, n)						\
+  LAYER_POOL_STORAGE(name, n);						\
+  MovLayer name##MovLayers[n];						\
+  MovLayerDesc name##MovLayerDescs[n];					\
+  LayerPool name = {name##Layers, name##MovLayers, name##LayerDescs,	\
+		    name##MovLayerDescs, name##Gens, name##Links, n}
+#elif LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+#define LAYER_POOL_AT(name, n, base)					\
+  u_char name##Gens[n], name##Links[n];					\
+  LayerPool name = {&layerArena[base], 0, name##Gens, name##Links, n}
+#define MOVLAYER_POOL_AT(name, n, base)				\
+  u_char name##Gens[n], name##Links[n];					\
+  MovLayer name##MovLayers[n];						\
+  LayerPool name = {&layerArena[base], name##MovLayers,		\
+		    name##Gens, name##Links, n}
+#else
+#define LAYER_POOL(name, n)						\
+  Layer name##Layers[n];						\
+  u_char name##Gens[n], name##Links[n];					\
+  LayerPool name = {name##Layers, 0, name##Gens, name##Links, n}
+#define MOVLAYER_POOL(name, n)						\
+  Layer name##Layers[n];						\
+  MovLayer name##MovLayers[n];						\
+  u_char name##Gens[n], name##Links[n];					\
+  LayerPool name = {name##Layers, name##MovLayers,			\
+		    name##Gens, name##Links, n}
+#endif
+
+/** Empties pool, which will draw above below (and move above movBelow)
+ */
+void layerPoolInit(LayerPool *pool, Layer *below, MovLayer *movBelow);
+
+/** Layers to draw: the pooled layers, top first, then below */
+#define layerPoolLayers(pool) \
+  ((pool)->top == LAYER_NONE ? (pool)->below : &(pool)->layers[(pool)->top])
+
+/** Moving layers to move: the pooled ones, then movBelow */
+#define layerPoolMovLayers(pool) \
+  ((pool)->top == LAYER_NONE ? (pool)->movBelow : &(pool)->movLayers[(pool)->top])
+
+/** Spawns a layer on top of the band at pos; velocity is ignored
+ *  without MovLayers.
+ *  Returns its handle, or LAYER_HANDLE_NONE if the pool is full.
+ */
+LayerHandle layerPoolSpawn(LayerPool *pool, const AbShape *shape, LayerColor color,
+			   const Vec2 *pos, const Vec2 *velocity);
+
+/** Despawns h's layer.  Returns 0 if h is stale.
+ */
+int layerPoolDespawn(LayerPool *pool, LayerHandle h);
+
+/** h's layer, or 0 if h is stale
+ */
+Layer *layerPoolLayer(const LayerPool *pool, LayerHandle h);
+
+/** h's moving layer, or 0 if h is stale or pool has no MovLayers
+ */
+MovLayer *layerPoolMovLayer(const LayerPool *pool, LayerHandle h);
+
+/** Redraws the pool's dirty region, compositing layers
+ */
+void layerPoolRedraw(LayerPool *pool, Layer *layers);
+
+/** Collision detection
+ *
+ *  Times are fractions of a step in fixed point: COLLIDE_ONE is the
+ *  whole step, from each layer's pos to its posNext.
+ */
+#define COLLIDE_SHIFT 8
+#define COLLIDE_ONE (1 << COLLIDE_SHIFT)
+
+/** First contact between two moving boxes during a step */
+typedef struct {
+  int time;			/* 0..COLLIDE_ONE; 0 if they already overlapped */
+  Vec2 normal;			/* unit axis pushing the first box away from the
+				   second, (0,0) if they already overlapped */
+} Contact;
+
+/** Sweeps box a moving by va and box b moving by vb over one step.
+ *  Boxes touch when they share a pixel; every contact is found whatever
+ *  the velocities, as if the boxes moved continuously.
+ *  Returns true (1) and sets *contact to the first contact if they touch.
+ */
+int regionSweep(const Region *a, const Vec2 *va, const Region *b, const Vec2 *vb,
+		Contact *contact);
+
+/** Sweeps the bounds of layers a and b from pos to posNext */
+int layerSweep(const Layer *a, const Layer *b, Contact *contact);
+
+/** How far one shape is inside another, for bouncing it off */
+typedef struct {
+  Vec2 normal;			/* unit axis pushing the first shape out:
+				   reflect the velocity along it */
+  int depth;			/* pixels to push it to separate them */
+} Penetration;
+
+/** Contact table of two circles: circleLib's circlePairA_B for radii A & B
+ *
+ *  Circles whose centers are dCol columns and dRow rows apart (both >= 0)
+ *  share a pixel iff dCol <= radius and chords[dCol] >= dRow.  rowChords
+ *  is the same table transposed: the largest dCol for each dRow.
+ */
+typedef struct {
+  const u_char *chords, *rowChords;
+  u_char radius;		/* the sum of the two radii */
+} CirclePair;
+
+/** True (1) if the circle centered at circlePos shares a pixel with rect,
+ *  in constant time.  If pen is not 0, sets it to the shallower way out
+ *  of rect (which at a corner steps along the circle's edge, at most a
+ *  pixel per pixel of depth).
+ */
+int circleRectOverlap(const AbCircle *circle, const Vec2 *circlePos, const Region *rect,
+		      Penetration *pen);
+
+/** True (1) if the pair's circles centered at aPos and bPos share a
+ *  pixel, in constant time.  If pen is not 0, sets it to push the first
+ *  out along the axis on which the centers are farther apart.
+ */
+int circlesOverlap(const CirclePair *pair, const Vec2 *aPos, const Vec2 *bPos,
+		   Penetration *pen);
+
+/** A contact found by collideLayers() */
+typedef struct {
+  Layer *a;			/* a moving layer */
+  Layer *b;			/* another moving layer, or a static one */
+  Contact contact;
+} CollideHit;
+
+/** Finds the contacts among movLayers and between them and the list of
+ *  static layers (which should not contain moving layers), over the
+ *  step from pos to posNext.  Up to maxHits are stored in hits, earliest
+ *  first; returns the number stored.
+ */
+u_char collideLayers(MovLayer *movLayers, Layer *statics, CollideHit *hits, u_char maxHits);
+
+/** A layer tracked by a broad phase */
+typedef struct {
+  Layer *layer;
+  Region bounds;		/* swept from pos to posNext, by broadPhasePairs() */
+  u_char category;		/* bits naming what the layer is */
+  u_char mask;			/* categories it collides with */
+} BroadEntry;
+
+/** Layers kept sorted by their leftmost column, so that broadPhasePairs()
+ *  only compares neighbors.  Declare with BROAD_PHASE(name, n).
+ */
+typedef struct {
+  BroadEntry *entries;
+  u_char count, capacity;
+} BroadPhase;
+
+#define BROAD_PHASE(name, n)						\
+  BroadEntry name##Entries[n];						\
+  BroadPhase name = {name##Entries, 0, n}
+
+/** Two layers whose swept bounds overlap */
+typedef struct {
+  Layer *a, *b;
+  u_char aCategory, bCategory;
+} LayerPair;
+
+/** Tracks layer l.  Two layers can collide if each one's category has a
+ *  bit in the other's mask.
+ *  Returns false (0) if the broad phase is full.
+ */
+int broadPhaseAdd(BroadPhase *bp, Layer *l, u_char category, u_char mask);
+
+/** Stops tracking l.  Returns false (0) if it was not tracked. */
+int broadPhaseRemove(BroadPhase *bp, const Layer *l);
+
+/** Updates the swept bounds of the tracked layers (from pos to posNext),
+ *  re-sorts them, and stores up to maxPairs pairs that can collide and
+ *  whose swept bounds overlap in pairs; further pairs are dropped.
+ *  Returns the number stored.
+ */
+u_char broadPhasePairs(BroadPhase *bp, LayerPair *pairs, u_char maxPairs);
+
+/** True (1) if layers a and b cover a common pixel at their current
+ *  positions.  Compares the rows of their overlapping bounds a run of
+ *  columns at a time and stops at the first common pixel, which is
+ *  stored in *contact (topmost, then leftmost) if contact is not 0.
+ */
+int shapesOverlap(Layer *a, Layer *b, Vec2 *contact);
+
+/** Like shapesOverlap(), but scans the whole overlap: stores the
+ *  bounding box of the common pixels (from the first to the last
+ *  contact row) in *contact and returns how many there are.
+ */
+int shapesContact(Layer *a, Layer *b, Region *contact);
+
+/** What happens when layers of two categories touch
+ *
+ *  handler(a, b, contact) is called for a layer a with a bit of categoryA
+ *  touching a layer b with a bit of categoryB (contact's normal pushes a
+ *  out of b).  A pair that fired only fires again once it has stayed
+ *  apart for cooldown ticks: 0 lets it fire on every tick it touches.
+ */
+typedef struct {
+  u_char categoryA, categoryB;
+  void (*handler)(Layer *a, Layer *b, const Contact *contact);
+  u_char cooldown;
+} CollisionRule;
+
+/** A contact waiting for collisionDispatch() */
+typedef struct {
+  Layer *a, *b;
+  Contact contact;
+  const CollisionRule *rule;
+} CollisionEvent;
+
+/** A pair that fired recently */
+typedef struct {
+  Layer *a, *b;
+  u_char ticks;			/* dispatches left until it may fire again */
+} CollisionCooldown;
+
+/** Collision rules and the events queued for them.  Declare with
+ *  COLLISION_REGISTRY(name, rules, nEvents, nCooldowns), where rules is
+ *  an array of CollisionRules (the first that matches a pair wins).
+ */
+typedef struct {
+  const CollisionRule *rules;
+  u_char nRules;
+  CollisionEvent *events;
+  u_char nEvents, maxEvents;
+  CollisionCooldown *cooldowns;
+  u_char nCooldowns, maxCooldowns;
+  u_char dropped;		/* events lost to a full queue */
+} CollisionRegistry;
+
+#define COLLISION_REGISTRY(name, rules, nEvents, nCooldowns)		\
+  CollisionEvent name##Events[nEvents];					\
+  CollisionCooldown name##Cooldowns[nCooldowns];			\
+  CollisionRegistry name = {rules, sizeof(rules) / sizeof((rules)[0]),	\
+			    name##Events, 0, nEvents,			\
+			    name##Cooldowns, 0, nCooldowns, 0}
+
+/** Queues a contact between layer a of aCategory and layer b of
+ *  bCategory (contact may be 0) for the first rule matching them, in
+ *  either order, unless the pair is cooling down.  Handlers only run in
+ *  collisionDispatch(), so this can be called from the physics pass.
+ *  Returns true (1) if an event was queued.
+ */
+int collisionPost(CollisionRegistry *reg, Layer *a, u_char aCategory,
+		  Layer *b, u_char bCategory, const Contact *contact);
+
+/** Sweeps the pairs that bp finds (up to maxPairs, in pairs) with
+ *  layerSweep() and posts their contacts.  Returns the number posted.
+ */
+u_char collisionDetect(CollisionRegistry *reg, BroadPhase *bp, LayerPair *pairs,
+		       u_char maxPairs);
+
+/** Calls the handlers of the queued events in the order they were
+ *  posted, empties the queue and ends the tick for the cooldowns.
+ */
+void collisionDispatch(CollisionRegistry *reg);
+
+/** Entity store
+ *
+ *  Game objects kept as parallel arrays indexed by entity id, so that
+ *  each system runs one tight loop over the ids it handles.  Entities
+ *  that are drawn also get a layer in a LayerPool: the renderer's view,
+ *  whose positions entityStoreSync() updates from the store.
+ */
+#define ENTITY_MOVES    0x01	/* integrated by entityStoreStep() */
+#define ENTITY_COLLIDES 0x02	/* paired by entityStoreCollide() */
+#define ENTITY_VISIBLE  0x04	/* drawn through a pool layer */
+#define ENTITY_ALIVE    0x40	/* slot in use, set by entitySpawn() */
+#define ENTITY_MOVED    0x80	/* reached another pixel since the last sync */
+
+#define ENTITY_NONE 0xff
+
+typedef struct {
+  u_char capacity;
+  const AbShape *const *shapes;	/* shape table that shape ids index */
+  Vec2 *pos;			/* pixels */
+  Vec2 *velocity;		/* Q8.8 pixels per tick */
+  u_char (*frac)[2];		/* position below a pixel, per axis */
+  Region *bounds;		/* bounds of the shape at pos */
+  u_char *shape;		/* shape ids */
+  LayerColor *color;
+  u_char *flags;		/* ENTITY_ bits */
+  u_char *category, *mask;	/* as in BroadPhase */
+  LayerHandle *layer;		/* view of visible entities in pool */
+  u_char *moving, nMoving;	/* ids each system loops over */
+  u_char *colliding, nColliding;
+  LayerPool *pool;
+} EntityStore;
+
+/** Declares EntityStore name of n entities whose shape ids index shapes */
+#define ENTITY_STORE(name, n, shapes)					\
+  Vec2 name##Pos[n], name##Velocity[n];					\
+  u_char name##Frac[n][2];						\
+  Region name##Bounds[n];						\
+  u_char name##Shape[n];						\
+  LayerColor name##Color[n];						\
+  u_char name##Flags[n], name##Category[n], name##Mask[n];		\
+  LayerHandle name##Layer[n];						\
+  u_char name##Moving[n], name##Colliding[n];				\
+  EntityStore name = {n, shapes, name##Pos, name##Velocity, name##Frac,	\
+		      name##Bounds, name##Shape, name##Color, name##Flags, \
+		      name##Category, name##Mask, name##Layer,		\
+		      name##Moving, 0, name##Colliding, 0, 0}
+
+/** Two entities whose bounds overlap */
+typedef struct {
+  u_char a, b;
+} EntityPair;
+
+/** Empties es; its visible entities will be drawn through pool's layers
+ *  (which need MovLayers).  pool may be 0 if none are visible.
+ */
+void entityStoreInit(EntityStore *es, LayerPool *pool);
+
+/** Adds an entity with velocity in Q8.8 pixels per tick.
+ *  Returns its id, or ENTITY_NONE if es (or its pool) is full.
+ */
+u_char entitySpawn(EntityStore *es, u_char shape, LayerColor color, u_char flags,
+		   u_char category, u_char mask, const Vec2 *pos, const Vec2 *velocity);
+
+/** Removes entity id from es and its systems */
+void entityDespawn(EntityStore *es, u_char id);
+
+/** Integrates the moving entities by one tick, moving their bounds with
+ *  them.  Returns how many reached another pixel.
+ */
+u_char entityStoreStep(EntityStore *es);
+
+/** Sorts the colliding entities by left column and stores up to
+ *  maxPairs pairs whose bounds overlap and whose categories and masks
+ *  match (as in BroadPhase).  Returns the number stored.
+ */
+u_char entityStoreCollide(EntityStore *es, EntityPair *pairs, u_char maxPairs);
+
+/** Sets the posNext of the layers of visible entities that moved, for
+ *  movLayerDraw(layerPoolMovLayers(pool), ...) to redraw them.
+ *  The compositor reads Layers, which also keep posLast for damage, so
+ *  positions are copied rather than drawn from the store: one Vec2 per
+ *  entity that reached another pixel (see benchEntity).
+ */
+void entityStoreSync(EntityStore *es);
+
 /** Background color.
   */
 extern u_int bgColor;		/*  background color */
@@ -0,0 +1,207 @@
+#include "shape.h"
+
+ShapeCache *shapeCache;
+
+/* Each sampled shape occupies, in the arena:
+ *   signed char top;		row of the first run, relative to center
+ *   u_char rows;
+ *   u_char firstRun[rows + 1];	row r's runs are firstRun[r] .. firstRun[r+1]-1
+ *   signed char runs[2 * nRuns];	colStart, colEnd relative to center
+ */
+#define ENTRY_TOP 0
+#define ENTRY_ROWS 1
+#define ENTRY_FIRST_RUN 2
+
+static ShapeCacheEntry *
+shapeCacheFind(ShapeCache *cache, const AbShape *s)
+{
+  ShapeCacheEntry *e = cache->entries;
+  u_char i;
+  for (i = cache->entryCount; i; i--, e++)
+    if (e->abShape == s)
+      return e;
+  return 0;
+}
+
+int
+shapeCacheHas(ShapeCache *cache, const AbShape *s)
+{
+  return shapeCacheFind(cache, s) != 0;
+}
+
+int
+shapeCacheAdd(ShapeCache *cache, const AbShape *s)
+{
+  ShapeCacheEntry *e;
+  if (shapeCacheFind(cache, s))
+    return 1;
+  if (cache->entryCount == cache->entryMax)
+    return 0;
+  e = &cache->entries[cache->entryCount++];
+  e->abShape = s;
+  e->size = e->lastUse = 0;
+  e->tooBig = e->noRoom = 0;
+  return 1;
+}
+
+/* frees e's runs, moving the runs sampled after them down */
+static void
+shapeCacheDrop(ShapeCache *cache, ShapeCacheEntry *e)
+{
+  ShapeCacheEntry *other = cache->entries;
+  u_int i;
+  if (!e->size)
+    return;
+  for (i = e->offset + e->size; i < cache->arenaUsed; i++)
+    cache->arena[i - e->size] = cache->arena[i];
+  for (i = cache->entryCount; i; i--, other++)
+    if (other->size && other->offset > e->offset)
+      other->offset -= e->size;
+  cache->arenaUsed -= e->size;
+  e->size = 0;
+}
+
+void
+shapeCacheInvalidate(ShapeCache *cache, const AbShape *s)
+{
+  ShapeCacheEntry *e = cache->entries;
+  u_char i;
+  for (i = cache->entryCount; i; i--, e++)
+    if (!s || e->abShape == s) {
+      shapeCacheDrop(cache, e);
+      e->tooBig = e->noRoom = 0;
+    }
+}
+
+/** Samples s into data, or only sizes it when data is 0.
+ *  Returns the bytes needed, 0 if s cannot be stored.
+ *  s is sampled around screenCenter, since some getBounds clip to the
+ *  screen, and its runs stored relative to that center.
+ */
+static u_int
+shapeCacheSample(const AbShape *s, u_char *data)
+{
+  Region bounds;
+  int row, col, top, rows;
+  u_int nRuns = 0;
+  signed char *runs;
+  abShapeGetBounds(s, &screenCenter, &bounds);
+  vec2Sub(&bounds.topLeft, &bounds.topLeft, &screenCenter);
+  vec2Sub(&bounds.botRight, &bounds.botRight, &screenCenter);
+  if (bounds.topLeft.axes[0] < -128 || bounds.topLeft.axes[1] < -128 ||
+      bounds.botRight.axes[0] > 127 || bounds.botRight.axes[1] > 127)
+    return 0;			/* offsets would not fit a signed char */
+  top = bounds.topLeft.axes[1];
+  rows = bounds.botRight.axes[1] - top + 1;
+  if (rows > 255)
+    return 0;
+  runs = data ? (signed char *)data + ENTRY_FIRST_RUN + rows + 1 : 0;
+  for (row = top; row <= bounds.botRight.axes[1]; row++) {
+    char inRun = 0;
+    if (data)
+      data[ENTRY_FIRST_RUN + row - top] = nRuns;
+    for (col = bounds.topLeft.axes[0]; col <= bounds.botRight.axes[0]; col++) {
+      Vec2 pixelPos = {screenCenter.axes[0] + col, screenCenter.axes[1] + row};
+      int covered = abShapeCheck(s, &screenCenter, &pixelPos);
+      if (covered && !inRun) {	/* start a run */
+	if (data)
+	  runs[2 * nRuns] = col;
+	nRuns++;
+      }
+      if (covered && data)
+	runs[2 * nRuns - 1] = col;
+      inRun = covered;
+    }
+  }
+  if (nRuns > 255)
+    return 0;
+  if (data) {
+    data[ENTRY_TOP] = top;
+    data[ENTRY_ROWS] = rows;
+    data[ENTRY_FIRST_RUN + rows] = nRuns;
+  }
+  return ENTRY_FIRST_RUN + rows + 1 + 2 * nRuns;
+}
+
+/* samples e's shape into the arena, evicting the least recently used
+   shapes that the draw in progress has not used */
+static int
+shapeCacheLoad(ShapeCache *cache, ShapeCacheEntry *e)
+{
+  u_int size = shapeCacheSample(e->abShape, 0);
+  e->noRoom = 0;
+  if (!size || size > cache->arenaSize) {
+    e->tooBig = 1;
+    return 0;
+  }
+  while (cache->arenaUsed + size > cache->arenaSize) {
+    ShapeCacheEntry *lru = 0, *other = cache->entries;
+    u_char i;
+    for (i = cache->entryCount; i; i--, other++)
+      if (other->size && other->lastUse != cache->clock &&
+	  (!lru || (u_int)(cache->clock - other->lastUse) >
+	   (u_int)(cache->clock - lru->lastUse)))
+	lru = other;
+    if (!lru) {			/* try again next draw */
+      e->noRoom = 1;
+      e->lastUse = cache->clock;
+      return 0;
+    }
+    shapeCacheDrop(cache, lru);
+    cache->evictions++;
+  }
+  e->offset = cache->arenaUsed;
+  e->size = size;
+  shapeCacheSample(e->abShape, cache->arena + e->offset);
+  cache->arenaUsed += size;
+  cache->misses++;
+  return 1;
+}
+
+int
+shapeCacheRun(ShapeCache *cache, const AbShape *s, const Vec2 *centerPos,
+	      const Vec2 *pixelLoc, int *runEnd)
+{
+  ShapeCacheEntry *e = shapeCacheFind(cache, s);
+  const u_char *data;
+  const signed char *runs;
+  int row, col;
+  u_char i, rows;
+  if (!e || e->tooBig)
+    return -1;
+  if (!e->size) {
+    if (e->noRoom && e->lastUse == cache->clock)
+      return -1;		/* no room during this draw */
+    if (!shapeCacheLoad(cache, e))
+      return -1;
+  }
+  e->lastUse = cache->clock;
+  data = cache->arena + e->offset;
+  rows = data[ENTRY_ROWS];
+  row = pixelLoc->axes[1] - centerPos->axes[1] - (signed char)data[ENTRY_TOP];
+  col = pixelLoc->axes[0] - centerPos->axes[0];
+  *runEnd = RUN_END_MAX;
+  if (row < 0 || row >= rows)
+    return 0;
+  runs = (const signed char *)data + ENTRY_FIRST_RUN + rows + 1;
+  for (i = data[ENTRY_FIRST_RUN + row]; i < data[ENTRY_FIRST_RUN + row + 1]; i++) {
+    int colStart = runs[2 * i], colEnd = runs[2 * i + 1];
+    if (col < colStart) {
+      *runEnd = pixelLoc->axes[0] + colStart - col - 1;
+      return 0;
+    }
+    if (col <= colEnd) {
+      *runEnd = pixelLoc->axes[0] + colEnd - col;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+shapeCacheCheck(ShapeCache *cache, const AbShape *s, const Vec2 *centerPos,
+		const Vec2 *pixelLoc)
+{
+  int runEnd;
+  return shapeCacheRun(cache, s, centerPos, pixelLoc, &runEnd);
+}
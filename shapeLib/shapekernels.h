@@ -0,0 +1,169 @@
+/** \file shapekernels.h
+ *  \brief Row-span kernels of the built-in shapes.
+ *
+ *  Included by the files that dispatch on a shape's kind (see
+ *  SHAPE_KINDS in shape.h) so that the kernels are compiled inline
+ *  there rather than called through the shapes' check pointers.
+ *  Each returns coverage of pixel and sets *runEnd like abShapeRun().
+ */
+
+#ifndef shapekernels_included
+#define shapekernels_included
+
+#include "shape.h"
+
+/** Run of a row whose covered pixels are columns left..right (none if left > right) */
+static inline int
+spanRun(int left, int right, int col, int *runEnd)
+{
+  if (left > right || col > right) {
+    *runEnd = RUN_END_MAX;
+    return 0;
+  }
+  if (col < left) {
+    *runEnd = left - 1;
+    return 0;
+  }
+  *runEnd = right;
+  return 1;
+}
+
+static inline int
+rectKernel(const AbRect *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int dRow = pixel->axes[1] - centerPos->axes[1];
+  int halfCols = rect->halfSize.axes[0], halfRows = rect->halfSize.axes[1];
+  if (dRow < -halfRows || dRow > halfRows)
+    return spanRun(1, 0, 0, runEnd);
+  return spanRun(centerPos->axes[0] - halfCols, centerPos->axes[0] + halfCols,
+		 pixel->axes[0], runEnd);
+}
+
+static inline int
+rectOutlineKernel(const AbRectOutline *rect, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int dRow = pixel->axes[1] - centerPos->axes[1], col = pixel->axes[0];
+  int halfRows = rect->halfSize.axes[1];
+  int left = centerPos->axes[0] - rect->halfSize.axes[0];
+  int right = centerPos->axes[0] + rect->halfSize.axes[0];
+  if (dRow < -halfRows || dRow > halfRows)
+    return spanRun(1, 0, 0, runEnd);
+  if (dRow == -halfRows || dRow == halfRows) /* top & bottom edges are solid */
+    return spanRun(left, right, col, runEnd);
+  if (col <= left)		/* up to the left edge */
+    return spanRun(left, left, col, runEnd);
+  if (col < right) {		/* inside */
+    *runEnd = right - 1;
+    return 0;
+  }
+  return spanRun(right, right, col, runEnd);
+}
+
+static inline int
+rarrowKernel(const AbRArrow *arrow, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int size = arrow->size, halfSize = size / 2, quarterSize = halfSize / 2;
+  int row = pixel->axes[1] - centerPos->axes[1], reach;
+  row = (row >= 0) ? row : -row;	/* row = |row| */
+  if (row <= quarterSize)	/* through tip & stem */
+    reach = size;
+  else			/* tip only */
+    reach = halfSize;
+  /* covered: row <= (center col - col) <= reach */
+  return spanRun(centerPos->axes[0] - reach, centerPos->axes[0] - row,
+		 pixel->axes[0], runEnd);
+}
+
+static inline int
+circleKernel(const AbCircle *circle, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int row = pixel->axes[1] - centerPos->axes[1];
+  u_char lo = 0, hi = circle->radius;
+  row = (row >= 0) ? row : -row;	/* row = |row| */
+  if (row > circle->radius)
+    return spanRun(1, 0, 0, runEnd);
+  while (lo < hi) {		/* widest column distance whose chord reaches row */
+    u_char mid = (lo + hi + 1) >> 1;
+    if (circle->chords[mid] >= row)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return spanRun(centerPos->axes[0] - lo, centerPos->axes[0] + lo, pixel->axes[0], runEnd);
+}
+
+static inline int
+ellipseKernel(const AbEllipse *ellipse, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int row = pixel->axes[1] - centerPos->axes[1];
+  u_char halfWidth;
+  row = (row >= 0) ? row : -row;	/* row = |row| */
+  if (row > ellipse->rowRadius)
+    return spanRun(1, 0, 0, runEnd);
+  halfWidth = ellipse->chords[row];
+  return spanRun(centerPos->axes[0] - halfWidth, centerPos->axes[0] + halfWidth,
+		 pixel->axes[0], runEnd);
+}
+
+static inline int
+annulusKernel(const AbAnnulus *annulus, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int row = pixel->axes[1] - centerPos->axes[1], col = pixel->axes[0];
+  int center = centerPos->axes[0];
+  u_char outer, inner;
+  row = (row >= 0) ? row : -row;	/* row = |row| */
+  if (row > annulus->outerRadius)
+    return spanRun(1, 0, 0, runEnd);
+  outer = annulus->outer[row];
+  if (row > annulus->innerRadius)	/* above & below the hole */
+    return spanRun(center - outer, center + outer, col, runEnd);
+  inner = annulus->inner[row];
+  if (inner >= outer)
+    return spanRun(1, 0, 0, runEnd);
+  if (col < center - inner)	/* left of the hole */
+    return spanRun(center - outer, center - inner - 1, col, runEnd);
+  if (col <= center + inner) {	/* in the hole */
+    *runEnd = center + inner;
+    return 0;
+  }
+  return spanRun(center + inner + 1, center + outer, col, runEnd);
+}
+
+static const u_char bitmapMask[8] = {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
+
+#define bitmapBit(rowBits, c) ((rowBits)[(c) >> 3] & bitmapMask[(c) & 7])
+
+static inline int
+bitmapKernel(const AbBitmap *bitmap, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  int col = pixel->axes[0] - centerPos->axes[0] + bitmap->centerCol;
+  int row = pixel->axes[1] - centerPos->axes[1] + bitmap->centerRow;
+  const u_char *rowBits;
+  int first, last, end, covered;
+  u_char fill;
+
+  if (row < 0 || row >= bitmap->height)
+    return spanRun(1, 0, 0, runEnd);
+  first = bitmap->rowFirst[row];
+  last = bitmap->rowLast[row];
+  if (first > last || col > last)	/* nothing more on this row */
+    return spanRun(1, 0, 0, runEnd);
+  if (col < first) {		/* before the first set pixel */
+    *runEnd = pixel->axes[0] + first - col - 1;
+    return 0;
+  }
+  rowBits = bitmap->bits + (row << bitmap->rowShift);
+  covered = bitmapBit(rowBits, col) != 0;
+  fill = covered ? 0xff : 0;
+  for (end = col; end < last; end++) {
+    /* skip whole bytes of the same color */
+    while (!((end + 1) & 7) && end + 8 <= last && rowBits[(end + 1) >> 3] == fill)
+      end += 8;
+    if (end >= last || (bitmapBit(rowBits, end + 1) != 0) != covered)
+      break;
+  }
+  *runEnd = pixel->axes[0] + end - col;
+  return covered;
+}
+
+#endif // included
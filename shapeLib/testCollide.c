@@ -0,0 +1,425 @@
+// Checks the times of impact and normals found by regionSweep() and
+// collideLayers(), circleRectOverlap() and circlesOverlap() at random
+// placements against the circles' pixels, and the events, cooldowns and
+// queue of a CollisionRegistry.
+// Runs on the host, built by the Makefile.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "shape.h"
+
+u_int bad = 0;
+
+/** Sweeps a (moving by va) against b (moving by vb) and compares the
+ *  result with the expected one; time < 0 expects a miss.
+ */
+void
+expectSweep(const char *name, const Region *a, int vCol, int vRow, const Region *b,
+	    int time, int normalCol, int normalRow)
+{
+  Vec2 va = {vCol, vRow};
+  Contact contact;
+  int hit = regionSweep(a, &va, b, &vec2Zero, &contact);
+  if (time < 0 ? hit :
+      !hit || contact.time != time ||
+      contact.normal.axes[0] != normalCol || contact.normal.axes[1] != normalRow) {
+    printf("testCollide: %s: expected ", name);
+    if (time < 0)
+      printf("a miss, ");
+    else
+      printf("time %d normal (%d,%d), ", time, normalCol, normalRow);
+    if (hit)
+      printf("got time %d normal (%d,%d)\n", contact.time,
+	     contact.normal.axes[0], contact.normal.axes[1]);
+    else
+      printf("got a miss\n");
+    bad++;
+  }
+}
+
+/* two 5x5 boxes one column apart, and b moved off a's rows */
+const Region a = {{0, 0}, {4, 4}};
+const Region b = {{5, 0}, {9, 4}};
+const Region bLow = {{5, 10}, {9, 14}};
+const Region bFar = {{6, 0}, {10, 4}};
+
+/* the game's blue square rising towards a bar */
+const AbRect bar = {abRectGetBounds, abRectCheck, {20,2}};
+const AbRect square = {abRectGetBounds, abRectCheck, {6,6}};
+LAYER(barLayer, &bar, COLOR_RED, screenWidth/2, 100, 0);
+LAYER(squareLayer, &square, COLOR_BLUE, screenWidth/2, 120, 0);
+MOVLAYER(mlSquare, &squareLayer, 0, 0, 0);
+
+/** Moves the square by (0,vRow) and collides it with the bar */
+void
+expectLayers(const char *name, int col, int vRow, int time)
+{
+  CollideHit hits[2];
+  Vec2 pos = {col, 120}, posNext = {col, 120 + vRow};
+  u_char n;
+  squareLayer.pos = pos;
+  squareLayer.posNext = posNext;
+  n = collideLayers(&mlSquare, &barLayer, hits, 2);
+  if (time < 0 ? n != 0 :
+      n != 1 || hits[0].a != &squareLayer || hits[0].b != &barLayer ||
+      hits[0].contact.time != time ||
+      hits[0].contact.normal.axes[0] != 0 || hits[0].contact.normal.axes[1] != 1) {
+    printf("testCollide: %s: expected %d hit(s) at time %d, got %d", name,
+	   time >= 0, time, n);
+    if (n)
+      printf(" at time %d normal (%d,%d)", hits[0].contact.time,
+	     hits[0].contact.normal.axes[0], hits[0].contact.normal.axes[1]);
+    printf("\n");
+    bad++;
+  }
+}
+
+/* circles of radius 3, 5, 10 and 20, and their pairs' contact tables */
+#define N_RADII 4
+u_char chords[N_RADII][21];
+const AbCircle circles[N_RADII] = {
+  {abCircleGetBounds, abCircleCheck, chords[0], 3},
+  {abCircleGetBounds, abCircleCheck, chords[1], 5},
+  {abCircleGetBounds, abCircleCheck, chords[2], 10},
+  {abCircleGetBounds, abCircleCheck, chords[3], 20},
+};
+u_char pairChords[N_RADII][N_RADII][41], pairRowChords[N_RADII][N_RADII][41];
+CirclePair pairs[N_RADII][N_RADII];
+
+/** True if circle c at pos shares a pixel with rect, pixel by pixel */
+int
+circleRectPixels(const AbCircle *c, const Vec2 *pos, const Region *rect)
+{
+  Vec2 pixel;
+  for (pixel.axes[1] = rect->topLeft.axes[1]; pixel.axes[1] <= rect->botRight.axes[1]; pixel.axes[1]++)
+    for (pixel.axes[0] = rect->topLeft.axes[0]; pixel.axes[0] <= rect->botRight.axes[0]; pixel.axes[0]++)
+      if (abCircleCheck(c, pos, &pixel))
+	return 1;
+  return 0;
+}
+
+/** True if circles a at aPos and b at bPos share a pixel, pixel by pixel */
+int
+circlesPixels(const AbCircle *a, const Vec2 *aPos, const AbCircle *b, const Vec2 *bPos)
+{
+  Region box = {{aPos->axes[0] - a->radius, aPos->axes[1] - a->radius},
+		{aPos->axes[0] + a->radius, aPos->axes[1] + a->radius}};
+  Vec2 pixel;
+  for (pixel.axes[1] = box.topLeft.axes[1]; pixel.axes[1] <= box.botRight.axes[1]; pixel.axes[1]++)
+    for (pixel.axes[0] = box.topLeft.axes[0]; pixel.axes[0] <= box.botRight.axes[0]; pixel.axes[0]++)
+      if (abCircleCheck(a, aPos, &pixel) && abCircleCheck(b, bPos, &pixel))
+	return 1;
+  return 0;
+}
+
+/** Builds the circles, and each pair's contact table from their pixels.
+ *  Checks that it is the max-sum of the two chord tables, as circleLib's
+ *  makeCircles generates it.
+ */
+void
+circlesInit()
+{
+  u_char i, j;
+  for (i = 0; i < N_RADII; i++) {
+    int r = circles[i].radius, row, col = r;
+    for (row = 0; row <= r; row++) {
+      while (col * col + row * row > r * r)
+	col--;
+      chords[i][row] = col;
+    }
+  }
+  for (i = 0; i < N_RADII; i++)
+    for (j = 0; j < N_RADII; j++) {
+      CirclePair *pair = &pairs[i][j];
+      Vec2 aPos = {64, 80}, bPos;
+      int d, dRow, col, best;
+      pair->radius = circles[i].radius + circles[j].radius;
+      for (d = 0; d <= pair->radius; d++) {
+	bPos.axes[0] = aPos.axes[0] + d;
+	for (dRow = pair->radius; dRow > 0; dRow--) {
+	  bPos.axes[1] = aPos.axes[1] + dRow;
+	  if (circlesPixels(&circles[i], &aPos, &circles[j], &bPos))
+	    break;
+	}
+	pairChords[i][j][d] = dRow;
+	for (col = 0, best = 0; col <= d; col++)
+	  if (col <= circles[i].radius && d - col <= circles[j].radius &&
+	      chords[i][col] + chords[j][d - col] > best)
+	    best = chords[i][col] + chords[j][d - col];
+	if (best != dRow) {
+	  printf("testCollide: circles %d and %d, %d apart: max-sum %d, pixels %d\n",
+		 circles[i].radius, circles[j].radius, d, best, dRow);
+	  bad++;
+	}
+      }
+      for (dRow = 0, d = pair->radius; dRow <= pair->radius; dRow++) {
+	while (d > 0 && pairChords[i][j][d] < dRow)
+	  d--;
+	pairRowChords[i][j][dRow] = d;
+      }
+      pair->chords = pairChords[i][j];
+      pair->rowChords = pairRowChords[i][j];
+    }
+}
+
+/** Reports pen unless pushing the circle by its depth along its normal
+ *  separates the shapes and one pixel less does not
+ */
+void
+checkPenetration(const char *name, const Penetration *pen, const Vec2 *pos,
+		 int (*overlaps)(const Vec2 *moved))
+{
+  Vec2 push = {pen->normal.axes[0] * pen->depth, pen->normal.axes[1] * pen->depth};
+  Vec2 moved, short1;
+  vec2Add(&moved, pos, &push);
+  vec2Sub(&short1, &moved, &pen->normal);
+  if (abs(pen->normal.axes[0]) + abs(pen->normal.axes[1]) != 1 || pen->depth < 1 ||
+      overlaps(&moved) || !overlaps(&short1)) {
+    printf("testCollide: %s at (%d,%d): depth %d along (%d,%d) does not just separate\n",
+	   name, pos->axes[0], pos->axes[1], pen->depth,
+	   pen->normal.axes[0], pen->normal.axes[1]);
+    bad++;
+  }
+}
+
+/* the placement being checked by the overlaps functions */
+const AbCircle *circleA, *circleB;
+Region rectB;
+Vec2 posB;
+
+int
+overlapsRect(const Vec2 *pos)
+{
+  return circleRectPixels(circleA, pos, &rectB);
+}
+
+int
+overlapsCircle(const Vec2 *pos)
+{
+  return circlesPixels(circleA, pos, circleB, &posB);
+}
+
+/** circleRectOverlap() and circlesOverlap() at n random placements */
+void
+checkCircles(int n)
+{
+  int k;
+  srand(1);
+  for (k = 0; k < n; k++) {
+    u_char i = rand() % N_RADII, j = rand() % N_RADII;
+    Vec2 pos = {64 + rand() % 61 - 30, 80 + rand() % 61 - 30};
+    Penetration pen;
+    int want, got;
+    circleA = &circles[i];
+    circleB = &circles[j];
+    rectB.topLeft.axes[0] = 64 + rand() % 21 - 10;
+    rectB.topLeft.axes[1] = 80 + rand() % 21 - 10;
+    rectB.botRight.axes[0] = rectB.topLeft.axes[0] + rand() % 20;
+    rectB.botRight.axes[1] = rectB.topLeft.axes[1] + rand() % 20;
+    want = overlapsRect(&pos);
+    got = circleRectOverlap(circleA, &pos, &rectB, &pen);
+    if (got != want) {
+      printf("testCollide: circle %d at (%d,%d) and rect (%d,%d)-(%d,%d): %d, not %d\n",
+	     circleA->radius, pos.axes[0], pos.axes[1], rectB.topLeft.axes[0],
+	     rectB.topLeft.axes[1], rectB.botRight.axes[0], rectB.botRight.axes[1], got, want);
+      bad++;
+    } else if (got)
+      checkPenetration("circle and rect", &pen, &pos, overlapsRect);
+
+    posB.axes[0] = 64;
+    posB.axes[1] = 80;
+    want = overlapsCircle(&pos);
+    got = circlesOverlap(&pairs[i][j], &pos, &posB, &pen);
+    if (got != want) {
+      printf("testCollide: circles %d at (%d,%d) and %d at (64,80): %d, not %d\n",
+	     circleA->radius, pos.axes[0], pos.axes[1], circleB->radius, got, want);
+      bad++;
+    } else if (got)
+      checkPenetration("circles", &pen, &pos, overlapsCircle);
+  }
+}
+
+/* collision events: the ship sets rocks off once until it stays clear
+   of them for 2 ticks, and walls on every tick; a rock thrown by the
+   ship hitting a wall hits the wall too */
+#define CAT_SHIP 1
+#define CAT_ROCK 2
+#define CAT_WALL 4
+
+void hitRock(Layer *a, Layer *b, const Contact *contact);
+void hitWall(Layer *a, Layer *b, const Contact *contact);
+
+const CollisionRule collisionRules[] = {
+  {CAT_SHIP, CAT_ROCK, hitRock, 2},
+  {CAT_SHIP | CAT_ROCK, CAT_WALL, hitWall, 0},
+};
+COLLISION_REGISTRY(collisions, collisionRules, 3, 2);
+
+LAYER(shipLayer, &square, COLOR_GREEN, 20, 20, 0);
+LAYER(rockLayer, &square, COLOR_BLACK, 32, 20, 0);
+LAYER(wallLayer, &bar, COLOR_RED, 20, 40, 0);
+
+char fired[32];			/* handler, a and b of each call: "rsr wsw" */
+Contact firedContacts[4];
+u_char nFired;
+
+/** One letter naming l */
+char
+layerLetter(const Layer *l)
+{
+  return l == &shipLayer ? 's' : l == &rockLayer ? 'r' : l == &wallLayer ? 'w' :
+    l == &squareLayer ? 'q' : l == &barLayer ? 'b' : '?';
+}
+
+/** Records a handler's call */
+void
+fire(char handler, Layer *a, Layer *b, const Contact *contact)
+{
+  char *s = fired + strlen(fired);
+  if (nFired < 4)
+    firedContacts[nFired] = *contact;
+  nFired++;
+  sprintf(s, "%s%c%c%c", s == fired ? "" : " ", handler, layerLetter(a), layerLetter(b));
+}
+
+void
+hitRock(Layer *a, Layer *b, const Contact *contact)
+{
+  fire('r', a, b, contact);
+}
+
+void
+hitWall(Layer *a, Layer *b, const Contact *contact)
+{
+  fire('w', a, b, contact);
+  if (a == &shipLayer)		/* posting from a handler */
+    collisionPost(&collisions, &rockLayer, CAT_ROCK, b, CAT_WALL, 0);
+}
+
+/** Dispatches the queued events and compares the handlers' calls */
+void
+expectDispatch(const char *name, const char *want)
+{
+  fired[0] = 0;
+  nFired = 0;
+  collisionDispatch(&collisions);
+  if (strcmp(fired, want) || collisions.nEvents) {
+    printf("testCollide: %s: dispatched \"%s\", not \"%s\", %d left\n", name, fired, want,
+	   collisions.nEvents);
+    bad++;
+  }
+}
+
+/** Posts a (of aCategory) touching b (of bCategory) and compares the result */
+void
+expectPost(const char *name, Layer *a, u_char aCategory, Layer *b, u_char bCategory,
+	   const Contact *contact, int want)
+{
+  int got = collisionPost(&collisions, a, aCategory, b, bCategory, contact);
+  if (got != want) {
+    printf("testCollide: %s: posted %d, not %d\n", name, got, want);
+    bad++;
+  }
+}
+
+/** Compares the contact of the nth handler call */
+void
+expectContact(const char *name, u_char n, int time, int normalCol, int normalRow)
+{
+  const Contact *c = &firedContacts[n];
+  if (n >= nFired || c->time != time ||
+      c->normal.axes[0] != normalCol || c->normal.axes[1] != normalRow) {
+    printf("testCollide: %s: expected time %d normal (%d,%d), got time %d normal (%d,%d)\n",
+	   name, time, normalCol, normalRow, c->time, c->normal.axes[0], c->normal.axes[1]);
+    bad++;
+  }
+}
+
+BROAD_PHASE(broadPhase, 2);
+LayerPair layerPairs[2];
+
+/** collisionPost(), collisionDispatch() and collisionDetect() */
+void
+checkEvents()
+{
+  Contact rockFirst = {5, {1, 0}};	/* pushes the rock out of the ship */
+  u_char n;
+
+  /* the rule names the ship first: swapped, with the normal turned round */
+  expectPost("rock on ship", &rockLayer, CAT_ROCK, &shipLayer, CAT_SHIP, &rockFirst, 1);
+  expectPost("rock on rock", &rockLayer, CAT_ROCK, &rockLayer, CAT_ROCK, &rockFirst, 0);
+  expectDispatch("rock on ship", "rsr");
+  expectContact("rock on ship", 0, 5, -1, 0);
+
+  /* cooling down: still touching, then clear for 1 tick, then for 2 */
+  expectPost("ship still on rock", &shipLayer, CAT_SHIP, &rockLayer, CAT_ROCK, 0, 0);
+  expectDispatch("ship still on rock", "");
+  expectDispatch("ship clear of rock", "");
+  expectPost("ship back on rock", &shipLayer, CAT_SHIP, &rockLayer, CAT_ROCK, 0, 0);
+  expectDispatch("ship back on rock", "");
+  expectDispatch("ship clear of rock", "");
+  expectDispatch("ship clear of rock", "");
+  expectPost("ship on rock again", &shipLayer, CAT_SHIP, &rockLayer, CAT_ROCK, 0, 1);
+  expectDispatch("ship on rock again", "rsr");
+  expectContact("no contact", 0, 0, 0, 0);
+
+  /* no cooldown: both fire, and the rocks they throw fill the queue */
+  expectPost("ship on wall", &shipLayer, CAT_SHIP, &wallLayer, CAT_WALL, &rockFirst, 1);
+  expectPost("ship on wall", &shipLayer, CAT_SHIP, &wallLayer, CAT_WALL, &rockFirst, 1);
+  collisions.dropped = 0;
+  expectDispatch("ship on wall", "wsw wsw wrw");
+  expectContact("ship on wall", 1, 5, 1, 0);
+  if (collisions.dropped != 1) {
+    printf("testCollide: %d events dropped, not 1\n", collisions.dropped);
+    bad++;
+  }
+
+  /* the square rising 30 towards the bar, found by the broad phase */
+  squareLayer.pos.axes[0] = screenWidth/2;
+  squareLayer.pos.axes[1] = 120;
+  squareLayer.posNext.axes[0] = screenWidth/2;
+  squareLayer.posNext.axes[1] = 90;
+  broadPhaseAdd(&broadPhase, &barLayer, CAT_WALL, CAT_SHIP);
+  broadPhaseAdd(&broadPhase, &squareLayer, CAT_SHIP, CAT_WALL);
+  n = collisionDetect(&collisions, &broadPhase, layerPairs, 2);
+  if (n != 1) {
+    printf("testCollide: square and bar: %d posted, not 1\n", n);
+    bad++;
+  }
+  expectDispatch("square and bar", "wqb");
+  expectContact("square and bar", 0, (12 * COLLIDE_ONE) / 30, 0, 1);
+}
+
+int
+main()
+{
+  layerInit(&barLayer);
+  /* one column to close: hit after 1/v of the step */
+  expectSweep("velocity 1", &a, 1, 0, &b, COLLIDE_ONE, -1, 0);
+  expectSweep("velocity 2", &a, 2, 0, &b, COLLIDE_ONE / 2, -1, 0);
+  expectSweep("velocity 3", &a, 3, 0, &b, COLLIDE_ONE / 3, -1, 0);
+  expectSweep("velocity 12", &a, 12, 0, &b, COLLIDE_ONE / 12, -1, 0); /* jumps past b */
+  expectSweep("velocity -3", &b, -3, 0, &a, COLLIDE_ONE / 3, 1, 0);
+  expectSweep("diagonal", &a, 3, 3, &b, COLLIDE_ONE / 3, -1, 0);
+  expectSweep("overlapping", &a, 1, 0, &a, 0, 0, 0);
+
+  expectSweep("short by one", &a, 1, 0, &bFar, -1, 0, 0);
+  expectSweep("other rows", &a, 12, 0, &bLow, -1, 0, 0);
+  expectSweep("moving away", &a, -12, 0, &b, -1, 0, 0);
+
+  /* the square's top is 12 rows below the bar's bottom */
+  expectLayers("square rising 12", screenWidth/2, -12, COLLIDE_ONE);
+  expectLayers("square rising 30", screenWidth/2, -30, (12 * COLLIDE_ONE) / 30);
+  expectLayers("square beside the bar", screenWidth/2 + 30, -30, -1);
+  expectLayers("square rising 11", screenWidth/2, -11, -1);
+
+  circlesInit();
+  checkCircles(20000);
+
+  checkEvents();
+
+  printf("testCollide: %u failed\n", bad);
+  return bad != 0;
+}
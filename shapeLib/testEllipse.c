@@ -0,0 +1,122 @@
+// Compares the spans of abEllipseRun() and abAnnulusRun() with
+// abEllipseCheck() and abAnnulusCheck(), pixel by pixel over the
+// shapes' bounds.  Runs on the host, built by the Makefile.
+
+#include <stdio.h>
+#include "shape.h"
+
+#define RADIUS_MAX 60
+
+/** chords[row] of an ellipse: the largest col with
+ *  (col/colRadius)^2 + (row/rowRadius)^2 <= 1
+ */
+void
+ellipseChords(u_char chords[], int colRadius, int rowRadius)
+{
+  long rr = (long)colRadius * colRadius * rowRadius * rowRadius;
+  int row, col = colRadius;
+  for (row = 0; row <= rowRadius; row++) {
+    while (col > 0 && (long)col * col * rowRadius * rowRadius +
+	   (long)row * row * colRadius * colRadius > rr)
+      col--;
+    chords[row] = col;
+  }
+}
+
+/* several places to draw each shape, some past the screen's edges */
+const Vec2 positions[] = {
+  {screenWidth/2, screenHeight/2}, {3, 20}, {screenWidth - 2, screenHeight - 5},
+};
+#define N_POSITIONS (sizeof positions / sizeof positions[0])
+
+unsigned long pixels, spans;
+u_int bad;
+
+typedef int (*RunFn)(const AbShape *s, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd);
+
+/** Walks every row of s's bounds (and two columns beyond each side) span
+ *  by span with run, checking each pixel of a span with s's check, and
+ *  that a span ends where the answer changes.
+ */
+void
+compareSpans(const char *name, const AbShape *s, RunFn run)
+{
+  u_char p;
+  for (p = 0; p < N_POSITIONS; p++) {
+    const Vec2 *center = &positions[p];
+    Region bounds;
+    Vec2 pixel;
+    abShapeGetBounds(s, center, &bounds);
+    for (pixel.axes[1] = bounds.topLeft.axes[1]; pixel.axes[1] <= bounds.botRight.axes[1];
+	 pixel.axes[1]++) {
+      int col = bounds.topLeft.axes[0] - 2, last = bounds.botRight.axes[0] + 2;
+      while (col <= last) {
+	int runEnd, covered;
+	pixel.axes[0] = col;
+	covered = run(s, center, &pixel, &runEnd);
+	spans++;
+	if (runEnd < col) {
+	  printf("testEllipse: %s at (%d,%d): span of (%d,%d) ends at %d\n", name,
+		 center->axes[0], center->axes[1], col, pixel.axes[1], runEnd);
+	  bad++;
+	  break;
+	}
+	for (; col <= runEnd && col <= last; col++) {
+	  pixel.axes[0] = col;
+	  pixels++;
+	  if (abShapeCheck(s, center, &pixel) != covered) {
+	    printf("testEllipse: %s at (%d,%d): pixel (%d,%d) is %d in its span\n", name,
+		   center->axes[0], center->axes[1], col, pixel.axes[1], !covered);
+	    bad++;
+	  }
+	}
+	pixel.axes[0] = col;
+	if (col <= last && abShapeCheck(s, center, &pixel) == covered) {
+	  printf("testEllipse: %s at (%d,%d): span ends early at (%d,%d)\n", name,
+		 center->axes[0], center->axes[1], runEnd, pixel.axes[1]);
+	  bad++;
+	}
+      }
+    }
+  }
+}
+
+/* ellipses: colRadius, rowRadius */
+const u_char ellipses[][2] = {
+  {1, 1}, {5, 5}, {10, 4}, {4, 10}, {30, 20}, {0, 12}, {12, 0}, {60, 50},
+};
+/* annuli: outer colRadius & rowRadius, inner colRadius & rowRadius */
+const u_char annuli[][4] = {
+  {10, 10, 5, 5}, {20, 20, 19, 19}, {30, 15, 10, 5}, {12, 12, 0, 0},
+  {12, 12, 0, 8},		/* a hole 0 columns wide: a slit */
+  {15, 15, 14, 0},		/* a hole 0 rows high */
+  {40, 40, 20, 30},
+};
+#define N_ELLIPSES (sizeof ellipses / sizeof ellipses[0])
+#define N_ANNULI (sizeof annuli / sizeof annuli[0])
+
+int
+main()
+{
+  u_char outer[RADIUS_MAX + 1], inner[RADIUS_MAX + 1];
+  char name[40];
+  u_char i;
+  for (i = 0; i < N_ELLIPSES; i++) {
+    AbEllipse e = {abEllipseGetBounds, abEllipseCheck, outer,
+		   ellipses[i][0], ellipses[i][1]};
+    ellipseChords(outer, e.colRadius, e.rowRadius);
+    sprintf(name, "ellipse %dx%d", e.colRadius, e.rowRadius);
+    compareSpans(name, (const AbShape *)&e, (RunFn)abEllipseRun);
+  }
+  for (i = 0; i < N_ANNULI; i++) {
+    AbAnnulus a = {abAnnulusGetBounds, abAnnulusCheck, outer, inner,
+		   annuli[i][1], annuli[i][3]};
+    ellipseChords(outer, annuli[i][0], annuli[i][1]);
+    ellipseChords(inner, annuli[i][2], annuli[i][3]);
+    sprintf(name, "annulus %dx%d - %dx%d", annuli[i][0], annuli[i][1],
+	    annuli[i][2], annuli[i][3]);
+    compareSpans(name, (const AbShape *)&a, (RunFn)abAnnulusRun);
+  }
+  printf("testEllipse: %lu pixels in %lu spans, %u wrong\n", pixels, spans, bad);
+  return bad != 0;
+}
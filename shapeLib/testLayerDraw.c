@@ -0,0 +1,189 @@
+// Composites layers with layerDraw() and compares every pixel of the
+// screen with what the layers' check functions say should be there.
+// Covers the span kernels with state of their own: instances, convex
+// polygons, transforms in all eight orientations and nested groups,
+// over a tile-map background.
+// Runs on the host, built by the Makefile.
+
+#include <stdio.h>
+#include "shape.h"
+#include "hostLcd.h"
+
+u_int bad;
+
+/** The background at pixel: tileMap's tile pixel, or bgColor */
+u_int
+background(const Vec2 *pixel)
+{
+  int x, y;
+  u_char tile, pair;
+  if (!tileMap)
+    return bgColor;
+  x = pixel->axes[0] - tileMap->origin.axes[0];
+  y = pixel->axes[1] - tileMap->origin.axes[1];
+  if (x < 0 || y < 0 || x >= tileMap->cols * TILE_SIZE || y >= tileMap->rows * TILE_SIZE)
+    return bgColor;
+  tile = tileMap->map[(y / TILE_SIZE) * tileMap->cols + x / TILE_SIZE];
+  pair = tileMap->tiles[tile * TILE_BYTES + (y % TILE_SIZE) * 4 + (x % TILE_SIZE) / 2];
+  return paletteColor(tileMap->paletteBase + (x % 2 ? pair & 0xf : pair >> 4));
+}
+
+/** Counts the pixels on the screen whose color is not the one of the
+ *  first layer whose shape's check covers them (for a group, the child's)
+ */
+void
+compareScreen(const char *name, Layer *layers)
+{
+  Vec2 pixel;
+  u_int wrong = 0;
+  for (pixel.axes[1] = 0; pixel.axes[1] < screenHeight; pixel.axes[1]++)
+    for (pixel.axes[0] = 0; pixel.axes[0] < screenWidth; pixel.axes[0]++) {
+      Layer *l;
+      u_int color = background(&pixel);
+      for (l = layers; l; l = layerNext(l))
+	if (abShapeCheck(layerShape(l), &l->pos, &pixel)) {
+	  color = layerColorBGR(layerColor(layerHit(l)));
+	  break;
+	}
+      wrong += hostScreen[pixel.axes[1]][pixel.axes[0]] != color;
+    }
+  if (wrong)
+    printf("testLayerDraw: %s: %u pixels wrong\n", name, wrong);
+  bad += wrong;
+}
+
+/** Draws layers and compares the screen */
+void
+compareDraw(const char *name, Layer *layers)
+{
+  layerDraw(layers);
+  compareScreen(name, layers);
+}
+
+/** Moves l to (col,row), as a step of a game would */
+void
+moveLayer(Layer *l, int col, int row)
+{
+  Vec2 pos = {col, row};
+  layerSetPosNext(l, &pos);
+  layerCommitPos(l);
+}
+
+/** chords of a circle of radius r */
+void
+circleChords(u_char chords[], int r)
+{
+  int row, col = r;
+  for (row = 0; row <= r; row++) {
+    while (col * col + row * row > r * r)
+      col--;
+    chords[row] = col;
+  }
+}
+
+u_char chords10[11];
+const AbCircle circle10 = {abCircleGetBounds, abCircleCheck, chords10, 10};
+const AbRect rect4 = {abRectGetBounds, abRectCheck, {4,4}};
+
+/* overlapping, on the same rows and off the top of the screen */
+InstancePos instancePositions[] = {
+  {0, 0}, {15, 4}, {30, 0}, {8, 30}, {40, 26}, {60, 40},
+};
+#define N_INSTANCES (sizeof instancePositions / sizeof instancePositions[0])
+AB_INSTANCES(discs, &circle10, instancePositions, N_INSTANCES);
+AB_INSTANCES(squares, &rect4, instancePositions, N_INSTANCES);
+
+LAYER(discsLayer, &discs, COLOR_RED, 10, 5, 0);
+LAYER(squaresLayer, &squares, COLOR_BLUE, 20, 90, &discsLayer);
+
+/* polygons: clockwise, counterclockwise, thin, over each other */
+AB_TRIANGLE(triangle, 0, -30, 25, 20, -25, 20);
+AB_TRIANGLE(sliver, -40, -2, 40, 1, -40, 3);
+const PolyVertex pentagonVertices[] = {	/* counterclockwise on screen */
+  {0, -20}, {-19, -6}, {-12, 16}, {12, 16}, {19, -6},
+};
+AB_CONVEX_POLY(pentagon, pentagonVertices, 5);
+
+LAYER(triangleLayer, &triangle, COLOR_GREEN, 60, 50, 0);
+LAYER(sliverLayer, &sliver, COLOR_BLACK, 50, 60, &triangleLayer);
+LAYER(pentagonLayer, &pentagon, COLOR_ORANGE, 80, 110, &sliverLayer);
+
+/* an arrow in every orientation, moved off its center, and a circle */
+const AbRArrow arrow12 = {abRArrowGetBounds, abRArrowCheck, 12};
+#define ARROW_VIEW(orient) \
+  {abTransformGetBounds, abTransformCheck, (const AbShape *)&arrow12, orient, {3, -2}}
+const AbTransform arrowViews[8] = {
+  ARROW_VIEW(0), ARROW_VIEW(1), ARROW_VIEW(2), ARROW_VIEW(3),
+  ARROW_VIEW(4), ARROW_VIEW(5), ARROW_VIEW(6), ARROW_VIEW(7),
+};
+const AbTransform circleView = {abTransformGetBounds, abTransformCheck,
+				(const AbShape *)&circle10, TRANSFORM_ROT_90, {0, 4}};
+
+LAYER(view0, &arrowViews[0], COLOR_RED, 20, 30, 0);
+LAYER(view1, &arrowViews[1], COLOR_GREEN, 50, 30, &view0);
+LAYER(view2, &arrowViews[2], COLOR_BLUE, 80, 30, &view1);
+LAYER(view3, &arrowViews[3], COLOR_BLACK, 110, 30, &view2);
+LAYER(view4, &arrowViews[4], COLOR_RED, 20, 70, &view3);
+LAYER(view5, &arrowViews[5], COLOR_GREEN, 50, 70, &view4);
+LAYER(view6, &arrowViews[6], COLOR_BLUE, 80, 70, &view5);
+LAYER(view7, &arrowViews[7], COLOR_BLACK, 110, 70, &view6);
+LAYER(circleViewLayer, &circleView, COLOR_ORANGE, 4, 120, &view7); /* off the left */
+
+/* a ship: a group holding a cabin group, a nose and a hull */
+LAYER(windowLayer, &rect4, COLOR_BLUE, -2, -8, 0);
+LAYER(cabinLayer, &pentagon, COLOR_BLACK, 0, -6, &windowLayer);
+AB_GROUP(cabin, &cabinLayer);
+LAYER(hullLayer, &circle10, COLOR_RED, 0, 0, 0);
+LAYER(noseLayer, &arrowViews[0], COLOR_GREEN, 14, 0, &hullLayer);
+LAYER(cabinGroupLayer, &cabin, COLOR_ORANGE, -4, -12, &noseLayer);
+AB_GROUP(ship, &cabinGroupLayer);
+LAYER(shipLayer, &ship, COLOR_ORANGE, 60, 80, &triangleLayer);
+
+/* a field of tiles, off the left edge and not aligned to the grid */
+u_char tiles[4 * TILE_BYTES];
+TILE_MAP(field, tiles, 12, 14, -5, 7, 2);
+
+int
+main()
+{
+  u_int i;
+  circleChords(chords10, 10);
+
+  layerInit(&squaresLayer);
+  compareDraw("instances", &squaresLayer);
+  moveLayer(&discsLayer, 40, 100); /* list again for another center */
+  compareDraw("instances moved", &squaresLayer);
+
+  layerInit(&pentagonLayer);
+  compareDraw("polygons", &pentagonLayer);
+  moveLayer(&triangleLayer, 10, 15);	/* partly off the left and top */
+  moveLayer(&pentagonLayer, 80, 55);	/* under the sliver */
+  compareDraw("polygons moved", &pentagonLayer);
+
+  layerInit(&circleViewLayer);
+  compareDraw("transforms", &circleViewLayer);
+
+  layerInit(&shipLayer);
+  moveLayer(&triangleLayer, 10, 15);
+  compareDraw("groups", &shipLayer);
+  moveLayer(&shipLayer, 118, 20);	/* partly off the right, over the triangle */
+  moveLayer(&triangleLayer, 110, 15);
+  compareDraw("groups moved", &shipLayer);
+
+  for (i = 0; i < sizeof tiles; i++)
+    tiles[i] = i * 7 + (i / TILE_BYTES) * 5;
+  for (i = 0; i < field.cols * field.rows; i++)
+    field.map[i] = (i + i / field.cols) % 4;
+  tileMap = &field;
+  compareDraw("tiles", &shipLayer);
+  tileMapSet(&field, 0, 0, 3);	/* under no layer, off the left */
+  tileMapSet(&field, 7, 2, 0);
+  tileMapSet(&field, 11, 13, 1);
+  tileMapSet(&field, 3, 5, field.map[5 * field.cols + 3]); /* unchanged */
+  tileMapRedraw(&field, &shipLayer);
+  compareScreen("tiles redrawn", &shipLayer);
+  tileMap = 0;
+
+  printf("testLayerDraw: %u pixels wrong\n", bad);
+  return bad != 0;
+}
@@ -0,0 +1,92 @@
+// Steps Motions of random Q8.8 velocities and accelerations and checks
+// their layers' posNext, and the count of layers moved, against exact
+// positions in 1/256ths of a pixel.  Runs on the host, built by the
+// Makefile.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "shape.h"
+
+#define N 16
+#define STEPS 400
+
+const AbRect rect3 = {abRectGetBounds, abRectCheck, {3,3}};
+
+Layer layers[N];
+Motion motions[N];
+long exact[N][2];		/* position in Q8.8, as a long */
+long exactVelocity[N][2];
+u_int bad;
+
+/* the example of MOTION's comment */
+LAYER(ballLayer, &rect3, COLOR_RED, 50, 100, 0);
+MOTION(ball, &ballLayer, 0.5, -2, 0, 0.125);
+
+int
+main()
+{
+  u_int step, i, axis, steps;
+  Vec2 pos;
+
+  srand(1);
+  for (i = 0; i < N; i++) {
+    Vec2 start = {rand() % 128, rand() % 160};
+    layers[i].abShape = (AbShape *)&rect3;
+    layers[i].pos = start;
+    motions[i].layer = &layers[i];
+    for (axis = 0; axis < 2; axis++) {
+      motions[i].velocity.axes[axis] = rand() % (4 * FIX_ONE) - 2 * FIX_ONE;
+      motions[i].accel.axes[axis] = rand() % 17 - 8;
+      exact[i][axis] = (long)start.axes[axis] << FIX_SHIFT;
+      exactVelocity[i][axis] = motions[i].velocity.axes[axis];
+    }
+    motions[i].frac[0] = motions[i].frac[1] = 0;
+  }
+  for (i = 0; i < N; i++)
+    layerInit(&layers[i]);
+
+  for (step = 0; step < STEPS; step++) {
+    u_char moved = 0, got;
+    for (i = 0; i < N; i++) {
+      int changed = 0;
+      for (axis = 0; axis < 2; axis++) {
+	long before = exact[i][axis] >> FIX_SHIFT;
+	exactVelocity[i][axis] += motions[i].accel.axes[axis];
+	exact[i][axis] += exactVelocity[i][axis];
+	changed |= (exact[i][axis] >> FIX_SHIFT) != before;
+      }
+      moved += changed;
+    }
+    got = motionStep(motions, N);
+    if (got != moved) {
+      printf("testMotion: step %u: %d layers moved, not %d\n", step, got, moved);
+      bad++;
+    }
+    for (i = 0; i < N; i++) {
+      layerGetPosNext(&layers[i], &pos);
+      if (pos.axes[0] != exact[i][0] >> FIX_SHIFT || pos.axes[1] != exact[i][1] >> FIX_SHIFT) {
+	printf("testMotion: step %u: layer %u at (%d,%d), not (%ld,%ld)\n", step, i,
+	       pos.axes[0], pos.axes[1], exact[i][0] >> FIX_SHIFT, exact[i][1] >> FIX_SHIFT);
+	bad++;
+      }
+      if (step % 3 == 2)	/* drawn every few steps */
+	layerCommitPos(&layers[i]);
+    }
+    if (bad)
+      break;
+  }
+
+  /* 0.5 and -2 pixels a step, accelerating by 0.125 down: after 16
+     steps 8 columns right, and -32 + 0.125 * (1 + ... + 16) = -15 rows */
+  layerInit(&ballLayer);
+  for (steps = 0; steps < 16; steps++)
+    motionStep(&ball, 1);
+  layerGetPosNext(&ballLayer, &pos);
+  if (pos.axes[0] != 58 || pos.axes[1] != 85) {
+    printf("testMotion: ball at (%d,%d), not (58,85)\n", pos.axes[0], pos.axes[1]);
+    bad++;
+  }
+
+  printf("testMotion: %d motions, %u steps, %u failed\n", N, step, bad);
+  return bad != 0;
+}
@@ -0,0 +1,122 @@
+// Spawns and despawns pooled layers at random and checks the pool's
+// layer and moving layer lists, handles and positions against a model.
+// Builds with any LAYER_LAYOUT.  Runs on the host, built by the Makefile.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "shape.h"
+#include "hostLcd.h"
+
+#define N 8
+
+const AbRect rect3 = {abRectGetBounds, abRectCheck, {3,3}};
+
+#if LAYER_LAYOUT == LAYER_LAYOUT_COMPACT
+Layer layerArena[N + 1] = {
+  LAYER_AT(N, &rect3, 1, 64, 80, LAYER_NONE),
+};
+MOVLAYER_POOL_AT(pool, N, 0);
+#define belowLayer layerArena[N]
+#else
+MOVLAYER_POOL(pool, N);
+LAYER(belowLayer, &rect3, COLOR_BLACK, 64, 80, 0);
+#endif
+
+/* the model: live handles, top of the band first, and their positions */
+LayerHandle live[N];
+Vec2 livePos[N];
+u_char nLive;
+u_int bad;
+
+/** Compares the pool with the model after op */
+void
+checkPool(const char *op)
+{
+  Layer *l = layerPoolLayers(&pool);
+  MovLayer *ml = layerPoolMovLayers(&pool);
+  u_char i;
+  for (i = 0; i < nLive; i++, l = layerNext(l), ml = movLayerNext(ml)) {
+    Vec2 pos;
+    if (l != layerPoolLayer(&pool, live[i]) || ml != layerPoolMovLayer(&pool, live[i]) ||
+	movLayerLayer(ml) != l) {
+      printf("testPool: after %s: layer %d of %d is not the one spawned\n", op, i, nLive);
+      bad++;
+      return;
+    }
+    layerGetPos(l, &pos);
+    if (pos.axes[0] != livePos[i].axes[0] || pos.axes[1] != livePos[i].axes[1]) {
+      printf("testPool: after %s: layer %d is at (%d,%d), not (%d,%d)\n", op, i,
+	     pos.axes[0], pos.axes[1], livePos[i].axes[0], livePos[i].axes[1]);
+      bad++;
+    }
+  }
+  if (l != &belowLayer || ml != 0 || pool.count != nLive) {
+    printf("testPool: after %s: the lists do not end after %d layers\n", op, nLive);
+    bad++;
+  }
+}
+
+/** Expects h to be refused */
+void
+checkStale(const char *op, LayerHandle h)
+{
+  if (layerPoolLayer(&pool, h) || layerPoolMovLayer(&pool, h) || layerPoolDespawn(&pool, h)) {
+    printf("testPool: after %s: stale handle %04x accepted\n", op, h);
+    bad++;
+  }
+}
+
+int
+main()
+{
+  LayerHandle stale[64];
+  u_int nStale = 0, op;
+  u_char i;
+  layerPoolInit(&pool, &belowLayer, 0);
+  checkPool("init");
+  for (op = 0; op < 5000; op++) {
+    if (nLive < N && (nLive == 0 || rand() % 2)) {
+      Vec2 pos = {10 + rand() % 100, 10 + rand() % 130};
+      LayerHandle h = layerPoolSpawn(&pool, (const AbShape *)&rect3, 1, &pos, &vec2Zero);
+      if (h == LAYER_HANDLE_NONE) {
+	printf("testPool: spawn refused with %d of %d in use\n", nLive, N);
+	bad++;
+	break;
+      }
+      for (i = nLive++; i; i--) { /* on top */
+	live[i] = live[i-1];
+	livePos[i] = livePos[i-1];
+      }
+      live[0] = h;
+      livePos[0] = pos;
+      checkPool("spawn");
+    } else {
+      u_char victim = rand() % nLive;
+      LayerHandle h = live[victim];
+      if (!layerPoolDespawn(&pool, h)) {
+	printf("testPool: live handle %04x refused\n", h);
+	bad++;
+	break;
+      }
+      for (i = victim, nLive--; i < nLive; i++) {
+	live[i] = live[i+1];
+	livePos[i] = livePos[i+1];
+      }
+      stale[nStale++ % 64] = h;
+      checkPool("despawn");
+    }
+    for (i = 0; i < 64 && i < nStale; i++) /* until the generations wrap */
+      checkStale(nLive ? "despawn" : "spawn", stale[i]);
+    if (nLive == N &&
+	layerPoolSpawn(&pool, (const AbShape *)&rect3, 1, &livePos[0], &vec2Zero) !=
+	LAYER_HANDLE_NONE) {
+      printf("testPool: spawned into a full pool\n");
+      bad++;
+    }
+    if (bad)
+      break;
+  }
+  layerPoolRedraw(&pool, layerPoolLayers(&pool));
+  printf("testPool: layout %d, %u spawns and despawns, %u failed\n", LAYER_LAYOUT, op, bad);
+  return bad != 0;
+}
@@ -0,0 +1,62 @@
+// Compares the shape cache's runs with the check functions they cache.
+// Runs on the host, built by the Makefile with $(HOST_SOURCES)
+
+#include <stdio.h>
+#include <assert.h>
+#include "shape.h"
+
+u_char chords30[31];
+const AbCircle circle30 = {abCircleGetBounds, abCircleCheck, chords30, 30};
+const AbRArrow rightArrow20 = {abRArrowGetBounds, abRArrowCheck, 20};
+const AbRect rect10 = {abRectGetBounds, abRectCheck, 10, 5};
+
+const AbShape *shapes[] = {
+  (const AbShape *)&circle30,
+  (const AbShape *)&rightArrow20,
+  (const AbShape *)&rect10,
+};
+#define N_SHAPES (sizeof shapes / sizeof shapes[0])
+
+/* centered, partly off each edge, and in a corner */
+const Vec2 positions[] = {
+  {screenWidth/2, screenHeight/2}, {10, 20}, {screenWidth - 5, 80},
+  {60, 3}, {64, screenHeight - 2}, {0, 0},
+};
+#define N_POSITIONS (sizeof positions / sizeof positions[0])
+
+SHAPE_CACHE(cache, 2048, 4);
+
+/** chords of a circle of radius r (circleLib's are not on the host) */
+void
+circleChords(u_char chords[], int r)
+{
+  int row, col = r;
+  for (row = 0; row <= r; row++) {
+    while (col * col + row * row > r * r)
+      col--;
+    chords[row] = col;
+  }
+}
+
+int
+main()
+{
+  u_int s, p, bad = 0, pixels = 0;
+  circleChords(chords30, 30);
+  for (s = 0; s < N_SHAPES; s++)
+    assert(shapeCacheAdd(&cache, shapes[s]));
+  for (s = 0; s < N_SHAPES; s++)
+    for (p = 0; p < N_POSITIONS; p++) {
+      Vec2 pixel;
+      for (pixel.axes[1] = 0; pixel.axes[1] < screenHeight; pixel.axes[1]++)
+	for (pixel.axes[0] = 0; pixel.axes[0] < screenWidth; pixel.axes[0]++) {
+	  int want = abShapeCheck(shapes[s], &positions[p], &pixel) != 0;
+	  int got = shapeCacheCheck(&cache, shapes[s], &positions[p], &pixel);
+	  assert(got >= 0);
+	  bad += got != want;
+	  pixels += want;
+	}
+    }
+  printf("testShapeCache: %u covered pixels, %u differ\n", pixels, bad);
+  return bad != 0;
+}
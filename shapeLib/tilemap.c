@@ -0,0 +1,90 @@
+#include "lcdutils.h"
+#include "shape.h"
+
+TileMap *tileMap;
+
+void
+tileMapRow(const TileMap *map, int row, TileCursor *cursor)
+{
+  int y = row - map->origin.axes[1];
+  cursor->map = map;
+  if (y < 0 || y >= (map->rows << TILE_SHIFT)) {
+    cursor->mapRow = 0;
+    return;
+  }
+  cursor->mapRow = map->map + (y >> TILE_SHIFT) * map->cols;
+  cursor->tileRow = (y & (TILE_SIZE - 1)) * (TILE_SIZE / 2);
+}
+
+void
+tileMapWrite(const TileCursor *cursor, int colStart, int colEnd)
+{
+  const TileMap *map = cursor->map;
+  const u_char *bits = 0;	/* the current tile's pixel row */
+  int x = colStart - map->origin.axes[0];
+  int width = map->cols << TILE_SHIFT;
+  for (; colStart <= colEnd; colStart++, x++) {
+    u_char pair;
+    if (!cursor->mapRow || x < 0 || x >= width) {
+      lcd_writeColor(bgColor);
+      continue;
+    }
+    if (!bits || !(x & (TILE_SIZE - 1)))	/* entering a tile */
+      bits = map->tiles + (cursor->mapRow[x >> TILE_SHIFT] << 5) + cursor->tileRow;
+    pair = bits[(x & (TILE_SIZE - 1)) >> 1];
+    lcd_writeColor(paletteColor(map->paletteBase + ((x & 1) ? pair & 0xf : pair >> 4)));
+  }
+}
+
+void
+tileMapSet(TileMap *map, u_char col, u_char row, u_char tile)
+{
+  u_int cell = row * map->cols + col;
+  if (col >= map->cols || row >= map->rows || map->map[cell] == tile)
+    return;
+  map->map[cell] = tile;
+  map->dirty[cell >> 3] |= 1 << (cell & 7);
+}
+
+void
+tileMapDirtyAll(TileMap *map)
+{
+  u_int i, n = (map->cols * map->rows + 7) / 8;
+  for (i = 0; i < n; i++)
+    map->dirty[i] = 0xff;
+}
+
+/* redraws cells colStart..colEnd of map row row */
+static void
+tileMapDrawCells(const TileMap *map, Layer *layers, u_char row, u_char colStart, u_char colEnd)
+{
+  Region r;
+  r.topLeft.axes[0] = map->origin.axes[0] + (colStart << TILE_SHIFT);
+  r.topLeft.axes[1] = map->origin.axes[1] + (row << TILE_SHIFT);
+  r.botRight.axes[0] = map->origin.axes[0] + ((colEnd + 1) << TILE_SHIFT) - 1;
+  r.botRight.axes[1] = r.topLeft.axes[1] + TILE_SIZE - 1;
+  layerDrawRegion(layers, &r);
+}
+
+void
+tileMapRedraw(TileMap *map, Layer *layers)
+{
+  u_char row, col;
+  u_int cell = 0;
+  for (row = 0; row < map->rows; row++) {
+    int first = -1;		/* start of a run of dirty cells */
+    for (col = 0; col < map->cols; col++, cell++) {
+      u_char *byte = &map->dirty[cell >> 3], bit = 1 << (cell & 7);
+      if (*byte & bit) {
+	*byte &= ~bit;
+	if (first < 0)
+	  first = col;
+      } else if (first >= 0) {
+	tileMapDrawCells(map, layers, row, first, col - 1);
+	first = -1;
+      }
+    }
+    if (first >= 0)
+      tileMapDrawCells(map, layers, row, first, map->cols - 1);
+  }
+}
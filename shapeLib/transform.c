@@ -0,0 +1,131 @@
+#include "shape.h"
+
+/* maps v, relative to the view's center, into abShape's frame */
+static void
+transformMap(u_char orient, Vec2 *v)
+{
+  if (orient & TRANSFORM_FLIP_H)
+    v->axes[0] = -v->axes[0];
+  if (orient & TRANSFORM_FLIP_V)
+    v->axes[1] = -v->axes[1];
+  if (orient & TRANSFORM_SWAP) {
+    int t = v->axes[0];
+    v->axes[0] = v->axes[1];
+    v->axes[1] = t;
+  }
+}
+
+/* inverse of transformMap: from abShape's frame into the view's */
+static void
+transformUnmap(u_char orient, Vec2 *v)
+{
+  transformMap(orient & TRANSFORM_SWAP, v);
+  transformMap(orient & ~TRANSFORM_SWAP, v);
+}
+
+/* bounds of abShape relative to its center, and of the view relative to
+   its center (offset included) */
+static void
+transformBounds(const AbTransform *t, Region *shapeBounds, Region *viewBounds)
+{
+  Region b;
+  abShapeGetBounds(t->abShape, &screenCenter, &b);
+  vec2Sub(&shapeBounds->topLeft, &b.topLeft, &screenCenter);
+  vec2Sub(&shapeBounds->botRight, &b.botRight, &screenCenter);
+  viewBounds->topLeft = shapeBounds->topLeft;
+  viewBounds->botRight = shapeBounds->botRight;
+  transformUnmap(t->orient, &viewBounds->topLeft);
+  transformUnmap(t->orient, &viewBounds->botRight);
+  b = *viewBounds;		/* corners may have swapped sides */
+  vec2Min(&viewBounds->topLeft, &b.topLeft, &b.botRight);
+  vec2Max(&viewBounds->botRight, &b.topLeft, &b.botRight);
+  vec2Add(&viewBounds->topLeft, &viewBounds->topLeft, &t->offset);
+  vec2Add(&viewBounds->botRight, &viewBounds->botRight, &t->offset);
+}
+
+/* pixel of abShape (centered at centerPos) seen at pixel of the view */
+static void
+transformSource(const AbTransform *t, const Vec2 *centerPos, const Vec2 *pixel, Vec2 *source)
+{
+  Vec2 rel;
+  vec2Sub(&rel, pixel, centerPos);
+  vec2Sub(&rel, &rel, &t->offset);
+  transformMap(t->orient, &rel);
+  vec2Add(source, centerPos, &rel);
+}
+
+void
+abTransformGetBounds(const AbTransform *t, const Vec2 *centerPos, Region *bounds)
+{
+  Region shapeBounds;
+  transformBounds(t, &shapeBounds, bounds);
+  vec2Add(&bounds->topLeft, &bounds->topLeft, centerPos);
+  vec2Add(&bounds->botRight, &bounds->botRight, centerPos);
+}
+
+int
+abTransformCheck(const AbTransform *t, const Vec2 *centerPos, const Vec2 *pixel)
+{
+  Vec2 source;
+  transformSource(t, centerPos, pixel, &source);
+  return abShapeCheck(t->abShape, centerPos, &source);
+}
+
+int
+abTransformRun(const AbTransform *t, const Vec2 *centerPos, const Vec2 *pixel, int *runEnd)
+{
+  Region shapeBounds, viewBounds;
+  Vec2 source;
+  int col = pixel->axes[0], covered, end;
+
+  transformSource(t, centerPos, pixel, &source);
+  if (!(t->orient & (TRANSFORM_SWAP | TRANSFORM_FLIP_H))) {
+    /* rows & columns run the same way as abShape's */
+    covered = abShapeRun(t->abShape, centerPos, &source, &end);
+    *runEnd = (end == RUN_END_MAX) ? RUN_END_MAX : col + end - source.axes[0];
+    return covered;
+  }
+
+  transformBounds(t, &shapeBounds, &viewBounds);
+  col -= centerPos->axes[0];	/* relative to the view's center */
+  if (col > viewBounds.botRight.axes[0] ||
+      pixel->axes[1] - centerPos->axes[1] < viewBounds.topLeft.axes[1] ||
+      pixel->axes[1] - centerPos->axes[1] > viewBounds.botRight.axes[1]) {
+    *runEnd = RUN_END_MAX;
+    return 0;
+  }
+  if (col < viewBounds.topLeft.axes[0]) {
+    *runEnd = pixel->axes[0] + viewBounds.topLeft.axes[0] - col - 1;
+    return 0;
+  }
+
+  if (!(t->orient & TRANSFORM_SWAP)) {
+    /* mirrored columns: find the run of abShape's row that ends (to
+       the view's right) at the start of the run holding source */
+    Vec2 start = {centerPos->axes[0] + shapeBounds.topLeft.axes[0], source.axes[1]};
+    for (;;) {
+      covered = abShapeRun(t->abShape, centerPos, &start, &end);
+      if (end >= source.axes[0])
+	break;
+      start.axes[0] = end + 1;
+    }
+    if (!covered && start.axes[0] <= centerPos->axes[0] + shapeBounds.topLeft.axes[0])
+      *runEnd = RUN_END_MAX;	/* nothing more on this row */
+    else
+      *runEnd = pixel->axes[0] + source.axes[0] - start.axes[0];
+    return covered;
+  }
+
+  /* a row of the view is a column of abShape: check pixel by pixel */
+  covered = abShapeCheck(t->abShape, centerPos, &source);
+  for (end = col; end < viewBounds.botRight.axes[0]; end++) {
+    source.axes[1] += (t->orient & TRANSFORM_FLIP_H) ? -1 : 1;
+    if (abShapeCheck(t->abShape, centerPos, &source) != covered)
+      break;
+  }
+  if (!covered && end >= viewBounds.botRight.axes[0])
+    *runEnd = RUN_END_MAX;
+  else
+    *runEnd = pixel->axes[0] + end - col;
+  return covered;
+}